@@ -24,22 +24,50 @@
 
 #include "callbacks.h"
 
+#include <mutex>
+
+static thread_local OutputCapture *s_outputCapture = nullptr;
+
+void print(const String &text)
+{
+	if (s_outputCapture)
+	{
+		s_outputCapture->m_text += text;
+		return;
+	}
+
+	static std::mutex s_outputMutex;
+	std::lock_guard<std::mutex> lock(s_outputMutex);
+	fwrite(text.c_str(), sizeof(char), text.length(), stdout);
+}
+
+OutputCapture::OutputCapture()
+	: m_previous(s_outputCapture)
+{
+	s_outputCapture = this;
+}
+
+OutputCapture::~OutputCapture()
+{
+	s_outputCapture = m_previous;
+}
+
 void(*info)(const String &level, const String &file, const String &msg)
 	= [](const String &level, const String &file, const String &msg) -> void
 	{
-		printf("[%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
+		print_f("[%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
 	};
 
 void(*error)(const String &level, const String &file, const String &msg)
 	= [](const String &level, const String &file, const String &msg) -> void
 	{
-		printf("<error> [%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
+		print_f("<error> [%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
 	};
 
 void(*warning)(const String &level, const String &file, const String &msg)
 	= [](const String &level, const String &file, const String &msg) -> void
 	{
-		printf("<warning> [%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
+		print_f("<warning> [%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
 	};
 
 /* eof */
@@ -22,6 +22,40 @@
 
 #pragma once
 
+/**
+ * Writes text to the standard output, whole text at once, so it is safe to call from many threads.
+ * When the calling thread has an active OutputCapture, the text is appended to the capture instead.
+ */
+void print(const String &text);
+
+template < typename ...Args >
+void print_f(const String &format, Args ...args)
+{
+	print(fmt::sprintf(format, args...));
+}
+
+/**
+ * Collects everything printed by the current thread during its lifetime.
+ * Used by parallel jobs to emit the output of every job as a single block.
+ */
+class OutputCapture
+{
+public:
+	OutputCapture();
+	OutputCapture(const OutputCapture &) = delete;
+	~OutputCapture();
+
+	OutputCapture &operator=(const OutputCapture &) = delete;
+
+	const String &text() const { return m_text; }
+
+private:
+	String m_text;
+	OutputCapture *m_previous;
+
+	friend void print(const String &text);
+};
+
 extern void(*info)(const String &level, const String &file, const String &msg);
 extern void(*error)(const String &level, const String &file, const String &msg);
 extern void(*warning)(const String &level, const String &file, const String &msg);
@@ -32,8 +32,20 @@
 #include <fs/file.h>
 #include <fs/sysfilesystem.h>
 #include <fs/uberfilesystem.h>
+#include <fs/hashfs_v2.h>
+#include <fs/index_cache.h>
+#include <fs/content_cache.h>
+#include <fs/io_plan.h>
+#include <fs/prefetcher.h>
+#include <fs/deduplicator.h>
+#include <fs/zipwriter.h>
+
+#include <utils/thread_pool.h>
+#include <utils/pixel_kernels.h>
+#include <config.h>
 
 #include <chrono>
+#include <mutex>
 
 void print_help()
 {
@@ -43,7 +55,17 @@ void print_help()
 		   "  -t <tobj_path>       - turns into single tobj mode and specifies tobj path (relative to base)\n"
 		   "  -d <dds_path>        - turns into single dds mode and prints debug info (absolute path)\n"
 		   "  -b <base_path>       - specify base path\n"
-		   "  -e <export_path>     - specify export path\n"
+		   "  -e <export_path>     - specify export path, path ending with .zip packs all the output into a single zip archive\n"
+		   "  -j <jobs>            - number of parallel jobs when converting whole base, textures of a model or extracting directory (0 = number of cores)\n"
+		   "  -deterministic       - print output of parallel jobs in the same order as with single job\n"
+		   "  -noMmap              - read .scs archives through file reads instead of mapping them into memory\n"
+		   "  -index_cache <dir>   - keep decoded archive indexes in the directory to speed up mounting\n"
+		   "  -gdeflate_threads n  - number of threads decoding a single GDeflate compressed file (0 = cores / jobs), -j workers decode serially\n"
+		   "  -cache_mb <size>     - memory budget for decompressed archive entries in MB (default 128, 0 = disabled)\n"
+		   "  -cache_stats         - prints hits and misses of the decompressed entries cache at the end\n"
+		   "  -prefetch_mb <size>  - memory budget for archive data read ahead of bulk operations in MB (default 64, 0 = disabled)\n"
+		   "  -dedup               - directory extraction links repeated files (reflink or hardlink) instead of writing them again\n"
+		   "  -bench_kernels       - prints throughput of pixel format conversion kernels and exits\n"
 		   "\n"
 		   " Usage:\n"
 		   "  converter_pix -b C:\\ets2_base -m /vehicle/truck/man_tgx/interior/anim s_wheel\n"
@@ -55,6 +77,12 @@ void print_help()
 		   "    ^ will convert whole base, it will export it into: <base_path>_exp (C:\\ets2_base_exp in this example).\n"
 		   "    ^ you can also specify export path using the -e parameter.\n"
 		   "\n"
+		   "  converter_pix -b C:\\ets2\\base.scs -b C:\\ets2\\def.scs -e C:\\ets2_base_exp\n"
+		   "    ^ will convert whole content of all mounted bases (directories or archives) without extracting them first.\n"
+		   "\n"
+		   "  converter_pix -b C:\\ets2\\base.scs -e C:\\ets2_base_exp.zip\n"
+		   "    ^ will convert whole base into a single zip archive instead of a directory tree.\n"
+		   "\n"
 		   "  converter_pix -b C:\\ets2_base -t /material/environment/vehicle_reflection.tobj\n"
 		   "    ^ will convert tobj file and copy texture to export path.\n"
 		   "\n"
@@ -72,7 +100,7 @@ void print_help()
 }
 
 bool convertSingleModel(String filepath, String exportpath, Array<String> optionalArgs);
-bool convertWholeBase(String basepath, String exportpath);
+bool convertWholeBase(String exportpath);
 
 int main(int argc, char *argv[])
 {
@@ -96,6 +124,12 @@ int main(int argc, char *argv[])
 	Array<String> basepath;
 	String exportpath;
 	String path;
+	String jobs;
+	String gdeflateThreads;
+	String cacheBudget;
+	String prefetchBudget;
+	bool cacheStats = false;
+	bool dedup = false;
 	bool listdir_r = false;
 
 	enum {
@@ -145,6 +179,34 @@ int main(int argc, char *argv[])
 		{
 			parameter = &exportpath;
 		}
+		else if (arg == "-j")
+		{
+			parameter = &jobs;
+		}
+		else if (arg == "-deterministic")
+		{
+			Config::s_deterministicOutput = true;
+		}
+		else if (arg == "-index_cache")
+		{
+			parameter = &IndexCache::s_directory;
+		}
+		else if (arg == "-gdeflate_threads")
+		{
+			parameter = &gdeflateThreads;
+		}
+		else if (arg == "-cache_mb")
+		{
+			parameter = &cacheBudget;
+		}
+		else if (arg == "-prefetch_mb")
+		{
+			parameter = &prefetchBudget;
+		}
+		else if (arg == "-cache_stats")
+		{
+			cacheStats = true;
+		}
 		else if (arg == "-d")
 		{
 			mode = DEBUG_DDS;
@@ -184,18 +246,63 @@ int main(int argc, char *argv[])
 		{
 			s_ddsDxt10 = true;
 		}
+		else if( arg == "-dedup" )
+		{
+			dedup = true;
+		}
+		else if( arg == "-bench_kernels" )
+		{
+			benchmarkPixelKernels();
+			return 0;
+		}
+		else if( arg == "-noMmap" )
+		{
+			HashFsV2::setMemoryMapping(false);
+		}
 		else
 		{
 			optionalArgs.push_back(arg);
 		}
 	}
 
+	if (!jobs.empty())
+	{
+		const int jobCount = atoi(jobs.c_str());
+		Config::s_jobs = jobCount > 0 ? static_cast<u32>(jobCount) : ThreadPool::hardwareThreadCount();
+	}
+
+	{
+		const int threadCount = atoi(gdeflateThreads.c_str());
+		Config::s_gdeflateWorkers = threadCount > 0 ? static_cast<u32>(threadCount) : std::max(1u, ThreadPool::hardwareThreadCount() / Config::s_jobs);
+	}
+
+	if (!cacheBudget.empty())
+	{
+		getContentCache()->setBudget(static_cast<uint64_t>(std::max(0, atoi(cacheBudget.c_str()))) * 1024 * 1024);
+	}
+
+	if (!prefetchBudget.empty())
+	{
+		getPrefetcher()->setBudget(static_cast<uint64_t>(std::max(0, atoi(prefetchBudget.c_str()))) * 1024 * 1024);
+	}
+
 	for (const auto &base : basepath)
 	{
 		static int priority = 1;
 		ufsMount(base, true, priority++);
 	}
 
+	UniquePtr<ZipWriterFileSystem> archiveOutput;
+	if (exportpath.length() > 4 && exportpath.substr(exportpath.length() - 4) == ".zip")
+	{
+		archiveOutput = std::make_unique<ZipWriterFileSystem>(exportpath);
+		if (!archiveOutput->good())
+		{
+			return 1;
+		}
+		setOutputFS(archiveOutput.get());
+	}
+
 	long long startTime =
 		std::chrono::duration_cast<std::chrono::milliseconds>
 		(std::chrono::system_clock::now().time_since_epoch()).count();
@@ -217,13 +324,13 @@ int main(int argc, char *argv[])
 		} break;
 		case DIRECTORY_LIST:
 		{
-			if (optionalArgs.size() == 0)
-			{
-				error("system", "", "Invalid parameters!");
-				return 1;
-			}
 			if (basepath.empty())
 			{
+				if (optionalArgs.size() == 0)
+				{
+					error("system", "", "Invalid parameters!");
+					return 1;
+				}
 				basepath.push_back(optionalArgs[0]);
 				static int priority = 1;
 				ufsMount(basepath[0], true, priority++);
@@ -232,7 +339,7 @@ int main(int argc, char *argv[])
 			{
 				exportpath = basepath[0] + "_exp";
 			}
-			convertWholeBase(basepath[0], exportpath);
+			convertWholeBase(exportpath);
 		} break;
 		case SINGLE_TOBJ:
 		{
@@ -247,7 +354,7 @@ int main(int argc, char *argv[])
 			}
 			backslashesToSlashes(path);
 			TextureObject tobj;
-			if (tobj.load(path))
+			if (tobj.load(path, true))
 			{
 				tobj.saveToMidFormats(exportpath);
 				printf("%s: tobj: yes\n", path.substr(directory(path).length() + 1).c_str());
@@ -271,8 +378,8 @@ int main(int argc, char *argv[])
 			{
 				exportpath = basepath[0] + "_exp";
 			}
-			SysFileSystem outputFileSystem( exportpath );
-			extractFile( *getUFS(), path, outputFileSystem );
+			SysFileSystem directoryOutput( exportpath );
+			extractFile( *getUFS(), path, archiveOutput ? *archiveOutput : static_cast<FileSystem &>( directoryOutput ) );
 		} break;
 		case SHOW_FILE:
 		{
@@ -306,19 +413,53 @@ int main(int argc, char *argv[])
 			{
 				exportpath = basepath[0] + "_exp";
 			}
-			SysFileSystem outputFileSystem( exportpath );
+			SysFileSystem directoryOutput( exportpath );
+			FileSystem &outputFileSystem = archiveOutput ? *archiveOutput : static_cast<FileSystem &>( directoryOutput );
 			auto files = getUFS()->readDir(path, true, true);
 			if (!files)
 			{
 				error("system", "", "readDir returned null!");
 				return 1;
 			}
+			Array<String> filepaths;
+			Array<String> directories;
 			for (const auto &f : *files)
 			{
 				if( !f.IsDirectory() )
 				{
-					extractFile( *getUFS(), f.GetPath(), outputFileSystem );
+					filepaths.push_back( f.GetPath() );
+					directories.push_back( directory( f.GetPath() ) );
+				}
+			}
+
+			// whole output tree is created up front, so opening a file for write never walks its path
+			if (!archiveOutput)
+			{
+				directoryOutput.mkdirs( std::move( directories ) );
+			}
+
+			sortByLocation( *getUFS(), filepaths );
+			getPrefetcher()->enqueue( *getUFS(), filepaths, archiveOutput ? Prefetcher::READ : Prefetcher::COPY );
+			UniquePtr<Deduplicator> deduplicator = dedup && !archiveOutput ? std::make_unique<Deduplicator>( directoryOutput ) : nullptr;
+			if (Config::s_jobs > 1)
+			{
+				ThreadPool pool(Config::s_jobs);
+				for (const String &filepath : filepaths)
+				{
+					pool.push([&outputFileSystem, &filepath, &deduplicator] { extractFile( *getUFS(), filepath, outputFileSystem, deduplicator.get() ); });
 				}
+				pool.wait();
+			}
+			else
+			{
+				for (const String &filepath : filepaths)
+				{
+					extractFile( *getUFS(), filepath, outputFileSystem, deduplicator.get() );
+				}
+			}
+			if (deduplicator)
+			{
+				printf("Deduplicated %llu files, %.2f MB not written\n", static_cast<unsigned long long>(deduplicator->linkedFiles()), deduplicator->savedBytes() / (1024.0 * 1024.0));
 			}
 		} break;
 		case LIST_DIR:
@@ -344,12 +485,30 @@ int main(int argc, char *argv[])
 		} break;
 	}
 
+	if (archiveOutput)
+	{
+		setOutputFS(nullptr);
+		if (!archiveOutput->finish())
+		{
+			return 1;
+		}
+	}
+
 	long long endTime =
 		std::chrono::duration_cast<std::chrono::milliseconds>
 		(std::chrono::system_clock::now().time_since_epoch()).count();
 
 	//printf("Time : %llums\n", endTime - startTime);
 
+	if (cacheStats)
+	{
+		ContentCache *const cache = getContentCache();
+		printf("Content cache: %llu hits, %llu misses, %llu KB held\n",
+			static_cast<unsigned long long>(cache->hits()),
+			static_cast<unsigned long long>(cache->misses()),
+			static_cast<unsigned long long>(cache->size() / 1024));
+	}
+
 	return 0;
 }
 
@@ -405,16 +564,81 @@ bool convertSingleModel(String filepath, String exportpath, Array<String> option
 	return true;
 }
 
-bool convertWholeBase(String basepath, String exportpath)
+/**
+ * Prints results of conversion jobs together with the progress.
+ * In deterministic mode a result is held back until all the preceding ones are printed.
+ */
+class ConversionOutput
+{
+public:
+	struct Result
+	{
+		String m_prologue; // printed before the progress
+		bool m_progress = false;
+		String m_text;
+	};
+
+public:
+	ConversionOutput(size_t size, bool deterministic)
+		: m_size(size)
+		, m_deterministic(deterministic)
+	{
+		if (m_deterministic)
+		{
+			m_waiting.resize(size);
+		}
+	}
+
+	void submit(size_t index, Result result)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_deterministic)
+		{
+			printResult(result);
+			return;
+		}
+
+		m_waiting[index] = std::move(result);
+		while (m_printed < m_size && m_waiting[m_printed].has_value())
+		{
+			const Result ready = std::move(m_waiting[m_printed].value());
+			m_waiting[m_printed].reset();
+			printResult(ready);
+		}
+	}
+
+private:
+	void printResult(const Result &result)
+	{
+		String text = result.m_prologue;
+		if (result.m_progress)
+		{
+			text += fmt::sprintf("[%u/%u = %u%%]: ", (unsigned)m_printed, (unsigned)m_size, (unsigned)(100.f * m_printed / m_size));
+		}
+		text += result.m_text;
+		print(text);
+		++m_printed;
+	}
+
+private:
+	std::mutex m_mutex;
+	const size_t m_size;
+	const bool m_deterministic;
+	size_t m_printed = 0;
+	Array<Optional<Result>> m_waiting;
+};
+
+bool convertWholeBase(String exportpath)
 {
-	auto files = getSFS()->readDir(basepath, true, true);
+	// every mounted base is enumerated, archives are converted straight from the archive
+	auto files = getUFS()->readDir("/", true, true);
 	if (!files)
 	{
 		printf("No files to convert!\n");
 		return false;
 	}
 
-	int size = 0;
+	Array<String> filenames; // relative to base
 	for (const auto &f : *files)
 	{
 		if (f.IsDirectory())
@@ -423,47 +647,87 @@ bool convertWholeBase(String basepath, String exportpath)
 		const Optional<String> extension = extractExtension(f.GetPath());
 		if (extension.has_value() && (extension.value() == ".pmg" || extension.value() == ".tobj"))
 		{
-			++size;
+			filenames.push_back(f.GetPath());
 		}
 	}
+	sortByLocation(*getUFS(), filenames);
 
-	int i = 0;
-	for (const auto &f : *files)
+	// files the conversion is going to read first, materials and textures are known only after the descriptor is parsed
+	Array<String> workList;
+	for (const String &filename : filenames)
 	{
-		if (f.IsDirectory())
-			continue;
+		workList.push_back(filename);
+		if (extractExtension(filename) == ".pmg")
+		{
+			const String modelPath = filename.substr(0, filename.length() - 4);
+			workList.push_back(modelPath + ".pmd");
+			workList.push_back(modelPath + ".pmc");
+		}
+	}
+	getPrefetcher()->enqueue(*getUFS(), workList, Prefetcher::READ);
 
-		const String filename = f.GetPath().substr(basepath.length());
-		const Optional<String> extension = extractExtension(f.GetPath());
-		if (extension == ".pmg")
+	ConversionOutput output(filenames.size(), Config::s_deterministicOutput);
+
+	auto convert = [&](size_t index)
+	{
+		const String &filename = filenames[index];
+		ConversionOutput::Result result;
+		if (extractExtension(filename) == ".pmg")
 		{
 			const String modelPath = filename.substr(0, filename.length() - 4);
 			Model model;
-			if (!model.load(modelPath))
+			bool loaded;
+			{
+				OutputCapture capture;
+				loaded = model.load(modelPath);
+				result.m_prologue = capture.text();
+			}
+			if (!loaded)
 			{
-				printf("Failed to load: %s\n", modelPath.c_str());
+				result.m_prologue += fmt::sprintf("Failed to load: %s\n", modelPath.c_str());
 			}
 			else
 			{
-				printf("[%u/%u = %u%%]: ", i, size, (unsigned)(100.f * i / size));
+				OutputCapture capture;
 				model.saveToMidFormat(exportpath, false);
+				result.m_progress = true;
+				result.m_text = capture.text();
 			}
-			++i;
 		}
-		else if (extension == ".tobj")
+		else
 		{
-			printf("[%u/%u = %u%%]: ", i, size, (unsigned)(100.f * i / size));
-			printf("%s: tobj: ", filename.substr(directory(filename).length() + 1).c_str());
+			OutputCapture capture;
+			print_f("%s: tobj: ", filename.substr(directory(filename).length() + 1).c_str());
 
 			TextureObject tobj;
-			if (tobj.load(filename))
+			if (tobj.load(filename, true))
 			{
 				tobj.saveToMidFormats(exportpath);
-				printf("ok\n");
+				print("ok\n");
 			}
-			++i;
+			result.m_progress = true;
+			result.m_text = capture.text();
+		}
+		output.submit(index, std::move(result));
+	};
+
+	if (Config::s_jobs > 1)
+	{
+		ThreadPool pool(Config::s_jobs);
+		for (size_t i = 0; i < filenames.size(); ++i)
+		{
+			pool.push([&convert, i] { convert(i); });
 		}
+		pool.wait();
 	}
+	else
+	{
+		for (size_t i = 0; i < filenames.size(); ++i)
+		{
+			convert(i);
+		}
+	}
+
 	printf("\nBase converted: %s\n", exportpath.c_str());
 	return false;
 }
@@ -25,5 +25,8 @@
 #include "config.h"
 
 bool Config::s_verbose = false;
+u32 Config::s_jobs = 1;
+bool Config::s_deterministicOutput = false;
+u32 Config::s_gdeflateWorkers = 0;
 
 /* eof */
@@ -26,6 +26,9 @@ class Config
 {
 public:
 	static bool s_verbose; /* TODO: To implement */
+	static u32 s_jobs; // number of worker threads used by bulk operations
+	static bool s_deterministicOutput; // parallel jobs print their output in the serial order
+	static u32 s_gdeflateWorkers; // number of threads decoding tiles of a single GDeflate stream
 };
 
 /* eof */
@@ -0,0 +1,92 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/cached_array.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include <stdexcept>
+
+/**
+ * Read-only array of plain elements, either owned or referring to a section of a mapped IndexCache.
+ * The referred section has to outlive the array, it is copied only when the array is modified.
+ */
+template< typename T >
+class CachedArray
+{
+	static_assert( std::is_trivially_copyable< T >::value, "Elements are stored as raw bytes in the cache." );
+
+public:
+	/**
+	 * Refers to the section instead of owning the elements, returns false when the size does not fit the element type.
+	 */
+	bool assign( const u8 *section, uint64_t size )
+	{
+		if( !section || size % sizeof( T ) != 0 )
+		{
+			return false;
+		}
+
+		m_storage.clear();
+		m_data = reinterpret_cast< const T * >( section );
+		m_size = static_cast< size_t >( size / sizeof( T ) );
+		return true;
+	}
+
+	/**
+	 * Returns owned elements for modification, elements of a referred section are copied first.
+	 */
+	Array<T> &storage()
+	{
+		if( m_data )
+		{
+			m_storage.assign( m_data, m_data + m_size );
+			m_data = nullptr;
+			m_size = 0;
+		}
+		return m_storage;
+	}
+
+	inline const T *data() const { return m_data ? m_data : m_storage.data(); }
+	inline size_t size() const { return m_data ? m_size : m_storage.size(); }
+	inline bool empty() const { return size() == 0; }
+	inline uint64_t byteSize() const { return uint64_t( size() ) * sizeof( T ); }
+
+	inline const T &operator[]( size_t index ) const { return data()[ index ]; }
+
+	const T &at( size_t index ) const
+	{
+		if( index >= size() )
+		{
+			throw std::out_of_range( "CachedArray::at" );
+		}
+		return data()[ index ];
+	}
+
+	inline const T *begin() const { return data(); }
+	inline const T *end() const { return data() + size(); }
+
+private:
+	Array<T> m_storage;
+	const T *m_data = nullptr; // referred section
+	size_t m_size = 0;
+};
+
+/* eof */
@@ -0,0 +1,224 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/content_cache.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "content_cache.h"
+
+#include "filesystem.h"
+
+ContentCache::ContentCache()
+	: m_budget( 128ull * 1024 * 1024 )
+{
+}
+
+ContentCache::~ContentCache() = default;
+
+auto ContentCache::find( const FileSystem *filesystem, u64 hash, uint64_t offset ) -> Content
+{
+	if( !enabled() )
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	const auto it = m_index.find( Key{ filesystem, hash, offset } );
+	if( it == m_index.end() )
+	{
+		++m_misses;
+		return nullptr;
+	}
+
+	++m_hits;
+	m_items.splice( m_items.begin(), m_items, it->second );
+	return it->second->m_content;
+}
+
+void ContentCache::insert( const FileSystem *filesystem, u64 hash, uint64_t offset, const void *data, uint64_t size )
+{
+	// a single entry must not flush the whole cache
+	if( !enabled() || size > m_budget / 4 )
+	{
+		return;
+	}
+
+	const Key key{ filesystem, hash, offset };
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if( m_index.find( key ) != m_index.end() )
+		{
+			return;
+		}
+	}
+
+	const u8 *const bytes = static_cast<const u8 *>( data );
+	Content content = std::make_shared<const Array<u8>>( bytes, bytes + size );
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if( m_index.find( key ) != m_index.end() ) // inserted by another thread meanwhile
+	{
+		return;
+	}
+	m_items.push_front( Item{ key, std::move( content ) } );
+	m_index[ key ] = m_items.begin();
+	m_size += size;
+	evict();
+}
+
+void ContentCache::remove( const FileSystem *filesystem )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	for( auto it = m_items.begin(); it != m_items.end(); )
+	{
+		if( it->m_key.m_filesystem == filesystem )
+		{
+			m_size -= it->m_content->size();
+			m_index.erase( it->m_key );
+			it = m_items.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void ContentCache::setBudget( uint64_t bytes )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_budget = bytes;
+	evict();
+}
+
+uint64_t ContentCache::size()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	return m_size;
+}
+
+void ContentCache::evict()
+{
+	while( m_size > m_budget && !m_items.empty() )
+	{
+		const Item &item = m_items.back();
+		m_size -= item.m_content->size();
+		m_index.erase( item.m_key );
+		m_items.pop_back();
+	}
+}
+
+size_t ContentCache::KeyHash::operator()( const Key &key ) const
+{
+	return std::hash<u64>()( key.m_hash ^ ( key.m_offset * 0x9E3779B97F4A7C15ull ) ^ reinterpret_cast<uintptr_t>( key.m_filesystem ) );
+}
+
+ContentCache *getContentCache()
+{
+	// never destroyed, filesystems owned by static objects (getUFS) still use it at exit
+	static ContentCache *const cache = new ContentCache();
+	return cache;
+}
+
+CachedFile::CachedFile( const String &filepath, FileSystem *filesystem, ContentCache::Content content )
+	: m_filepath( filepath )
+	, m_filesystem( filesystem )
+	, m_content( std::move( content ) )
+{
+}
+
+CachedFile::~CachedFile() = default;
+
+uint64_t CachedFile::write( const void *buffer, uint64_t elementSize, uint64_t elementCount )
+{
+	return 0;
+}
+
+uint64_t CachedFile::read( void *buffer, uint64_t elementSize, uint64_t elementCount )
+{
+	if( m_position >= m_content->size() )
+	{
+		return 0;
+	}
+
+	const uint64_t bytes = std::min( elementSize * elementCount, m_content->size() - m_position );
+	memcpy( buffer, m_content->data() + m_position, static_cast<size_t>( bytes ) );
+	m_position += bytes;
+	return bytes;
+}
+
+uint64_t CachedFile::size()
+{
+	return m_content->size();
+}
+
+bool CachedFile::seek( uint64_t offset, Attrib attr )
+{
+	if( attr == SeekSet )
+	{
+		m_position = offset;
+	}
+	else if( attr == SeekCur )
+	{
+		m_position += offset;
+	}
+	else if( attr == SeekEnd )
+	{
+		m_position = size() - offset;
+	}
+	return true;
+}
+
+void CachedFile::rewind()
+{
+	m_position = 0;
+}
+
+uint64_t CachedFile::tell() const
+{
+	return m_position;
+}
+
+void CachedFile::flush()
+{
+}
+
+void CachedFile::mstat( MetaStat *result )
+{
+	m_filesystem->mstat( result, m_filepath );
+}
+
+bool CachedFile::readAt( void *buffer, uint64_t offset, uint64_t size )
+{
+	if( offset > m_content->size() || size > m_content->size() - offset )
+	{
+		return false;
+	}
+	memcpy( buffer, m_content->data() + offset, static_cast<size_t>( size ) );
+	return true;
+}
+
+FileView CachedFile::view()
+{
+	return FileView( m_content->data(), m_content->size(), m_content );
+}
+
+/* eof */
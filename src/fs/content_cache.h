@@ -0,0 +1,137 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/content_cache.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include "file.h"
+
+#include <mutex>
+#include <atomic>
+
+class FileSystem;
+
+/**
+ * Byte-budgeted LRU cache of decompressed archive entries shared by all filesystems.
+ * Entries are identified by the filesystem, hash of the entry and offset of its data
+ * (the same entry may be opened with different plain metadata, e.g. tobj image data).
+ */
+class ContentCache
+{
+public:
+	using Content = SharedPtr<const Array<u8>>;
+
+public:
+	ContentCache();
+	ContentCache( const ContentCache & ) = delete;
+	ContentCache( ContentCache && ) = delete;
+	~ContentCache();
+
+	ContentCache &operator=( const ContentCache & ) = delete;
+	ContentCache &operator=( ContentCache && ) = delete;
+
+	Content find( const FileSystem *filesystem, u64 hash, uint64_t offset );
+	void insert( const FileSystem *filesystem, u64 hash, uint64_t offset, const void *data, uint64_t size );
+
+	/**
+	 * Drops every entry of the filesystem, must be called before the filesystem is destroyed.
+	 */
+	void remove( const FileSystem *filesystem );
+
+	/**
+	 * Zero budget disables the cache.
+	 */
+	void setBudget( uint64_t bytes );
+	inline bool enabled() const { return m_budget != 0; }
+
+	inline u64 hits() const { return m_hits; }
+	inline u64 misses() const { return m_misses; }
+	uint64_t size();
+
+private:
+	struct Key
+	{
+		const FileSystem *m_filesystem;
+		u64 m_hash;
+		uint64_t m_offset;
+
+		inline bool operator==( const Key &rhs ) const
+		{
+			return m_filesystem == rhs.m_filesystem && m_hash == rhs.m_hash && m_offset == rhs.m_offset;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()( const Key &key ) const;
+	};
+
+	struct Item
+	{
+		Key m_key;
+		Content m_content;
+	};
+
+private:
+	void evict();
+
+private:
+	std::mutex m_mutex;
+	List<Item> m_items; // the most recently used at the front
+	std::unordered_map<Key, List<Item>::iterator, KeyHash> m_index;
+
+	uint64_t m_budget;
+	uint64_t m_size = 0;
+
+	std::atomic<u64> m_hits = { 0 };
+	std::atomic<u64> m_misses = { 0 };
+};
+
+ContentCache *getContentCache();
+
+/**
+ * Read-only file over content held by the cache
+ */
+class CachedFile : public File
+{
+public:
+	CachedFile( const String &filepath, FileSystem *filesystem, ContentCache::Content content );
+	virtual ~CachedFile();
+
+	virtual uint64_t write( const void *buffer, uint64_t elementSize, uint64_t elementCount ) override;
+	virtual uint64_t read( void *buffer, uint64_t elementSize, uint64_t elementCount ) override;
+	virtual uint64_t size() override;
+	virtual bool seek( uint64_t offset, Attrib attr ) override;
+	virtual void rewind() override;
+	virtual uint64_t tell() const override;
+	virtual void flush() override;
+	virtual void mstat( MetaStat *result ) override;
+	virtual bool readAt( void *buffer, uint64_t offset, uint64_t size ) override;
+	virtual FileView view() override;
+
+private:
+	String m_filepath;
+	FileSystem *m_filesystem;
+	ContentCache::Content m_content;
+	uint64_t m_position = 0;
+};
+
+/* eof */
@@ -0,0 +1,213 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/deduplicator.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "deduplicator.h"
+
+#include "file.h"
+#include "sysfilesystem.h"
+
+Deduplicator::Deduplicator( SysFileSystem &destination )
+	: m_destination( destination )
+{
+}
+
+Deduplicator::~Deduplicator() = default;
+
+bool Deduplicator::extract( FileSystem &fileSystem, const String &filePath, File &input )
+{
+	// entries sharing the stored data are found without reading them
+	FileSystem::Location location;
+	const bool located = fileSystem.locate( filePath, &location ) && location.m_size != 0;
+	const LocationKey locationKey( location.m_filesystem, location.m_offset, location.m_size );
+	bool publishLocation = false;
+	if( located )
+	{
+		String existing;
+		publishLocation = claim( m_locations, locationKey, existing );
+		if( !publishLocation && !existing.empty() && link( existing, filePath, input.size() ) )
+		{
+			return true;
+		}
+	}
+
+	// stored data is hashed first and then copied by copyFile, which may copy it inside the kernel,
+	// other data is hashed while it is written, so it is not inflated twice
+	const uint64_t size = input.size();
+	uint64_t storageOffset = 0;
+	const bool stored = input.storage( &storageOffset ) != nullptr;
+	ContentHasher hasher;
+	bool written = false;
+	const bool hashed = stored ? hash( input, hasher ) : ( written = writeHashed( filePath, input, hasher ) );
+	if( !hashed )
+	{
+		if( publishLocation )
+		{
+			publish( m_locations, locationKey, String() );
+		}
+		return false;
+	}
+
+	const ContentKey contentKey( Uint128Low64( hasher.hash() ), Uint128High64( hasher.hash() ), size );
+	String existing;
+	const bool publishContent = size != 0 && claim( m_contents, contentKey, existing );
+
+	// a link replaces the copy written while hashing, that usually happens before it is flushed to the disk
+	bool extracted = written;
+	if( !publishContent && !existing.empty() )
+	{
+		extracted = link( existing, filePath, size );
+	}
+	if( !extracted )
+	{
+		extracted = copy( filePath, input );
+	}
+
+	const String published = extracted ? filePath : String();
+	if( publishLocation )
+	{
+		publish( m_locations, locationKey, published );
+	}
+	if( publishContent )
+	{
+		publish( m_contents, contentKey, published );
+	}
+	return extracted;
+}
+
+template< typename Key >
+bool Deduplicator::claim( Map<Key, Record> &records, const Key &key, String &existing )
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	const auto inserted = records.emplace( key, Record() );
+	if( inserted.second )
+	{
+		return true;
+	}
+
+	const Record &record = inserted.first->second;
+	m_published.wait( lock, [ &record ] { return record.m_ready; } );
+	existing = record.m_path;
+	return false;
+}
+
+template< typename Key >
+void Deduplicator::publish( Map<Key, Record> &records, const Key &key, const String &path )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		Record &record = records[ key ];
+		record.m_path = path;
+		record.m_ready = true;
+	}
+	m_published.notify_all();
+}
+
+bool Deduplicator::link( const String &existing, const String &filePath, uint64_t size )
+{
+	if( !m_destination.link( existing, filePath ) )
+	{
+		return false;
+	}
+	++m_linkedFiles;
+	m_savedBytes += size;
+	return true;
+}
+
+bool Deduplicator::hash( File &input, ContentHasher &hasher )
+{
+	input.rewind();
+	Array<u8> &buffer = chunkBuffer();
+	for( uint64_t remaining = input.size(); remaining > 0; )
+	{
+		const uint64_t bytes = std::min<uint64_t>( remaining, buffer.size() );
+		if( input.read( buffer.data(), 1, bytes ) != bytes )
+		{
+			return false;
+		}
+		hasher.update( buffer.data(), bytes );
+		remaining -= bytes;
+	}
+	return true;
+}
+
+bool Deduplicator::writeHashed( const String &filePath, File &input, ContentHasher &hasher )
+{
+	UniquePtr<File> output = create( filePath );
+	if( !output )
+	{
+		return false;
+	}
+
+	input.rewind();
+	Array<u8> &buffer = chunkBuffer();
+	for( uint64_t remaining = input.size(); remaining > 0; )
+	{
+		const uint64_t bytes = std::min<uint64_t>( remaining, buffer.size() );
+		if( input.read( buffer.data(), 1, bytes ) != bytes || !output->blockWrite( buffer.data(), bytes ) )
+		{
+			return false;
+		}
+		hasher.update( buffer.data(), bytes );
+		remaining -= bytes;
+	}
+	return true;
+}
+
+bool Deduplicator::copy( const String &filePath, File &input )
+{
+	UniquePtr<File> output = create( filePath );
+	if( !output )
+	{
+		return false;
+	}
+	input.rewind();
+	return copyFile( &input, output.get() );
+}
+
+UniquePtr<File> Deduplicator::create( const String &filePath )
+{
+	// breaks links made by an earlier extraction into the same directory
+	m_destination.remove( filePath );
+
+	UniquePtr<File> output = m_destination.open( filePath, FileSystem::write | FileSystem::binary );
+	if( !output )
+	{
+		print_f( "Unable to open file for write: %s\n", m_destination.FileSystem::root( filePath ).c_str() );
+	}
+	return output;
+}
+
+Array<u8> &Deduplicator::chunkBuffer()
+{
+	// every file is hashed in chunks of the same size, so equal contents hash equally whichever way they are read
+	thread_local Array<u8> buffer( static_cast<size_t>( ContentHasher::CHUNK_SIZE ) );
+	return buffer;
+}
+
+void Deduplicator::ContentHasher::update( const u8 *data, uint64_t size )
+{
+	m_hash = CityHash128WithSeed( reinterpret_cast<const char *>( data ), static_cast<size_t>( size ), m_hash );
+}
+
+/* eof */
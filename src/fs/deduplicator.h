@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/deduplicator.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include "filesystem.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <tuple>
+
+#include <cityhash/city.h>
+
+class SysFileSystem;
+
+/**
+ * Extracts files so that repeated payloads are written to the disk once.
+ * A file whose archive location or content matches an already extracted file is materialized
+ * as a reflink or a hardlink of that file, see SysFileSystem::link.
+ */
+class Deduplicator
+{
+public:
+	Deduplicator( SysFileSystem &destination );
+	Deduplicator( const Deduplicator & ) = delete;
+	Deduplicator( Deduplicator && ) = delete;
+	~Deduplicator();
+
+	Deduplicator &operator=( const Deduplicator & ) = delete;
+	Deduplicator &operator=( Deduplicator && ) = delete;
+
+	/**
+	 * Links the file to its earlier copy or writes it to the destination, may be called from several threads.
+	 */
+	bool extract( FileSystem &fileSystem, const String &filePath, File &input );
+
+	inline u64 linkedFiles() const { return m_linkedFiles; }
+	inline u64 savedBytes() const { return m_savedBytes; }
+
+private:
+	struct Record
+	{
+		String m_path; // extracted file holding the content, empty if it could not be extracted
+		bool m_ready = false;
+	};
+
+	using LocationKey = std::tuple<const FileSystem *, uint64_t, uint64_t>; // filesystem, offset, stored size
+	using ContentKey = std::tuple<u64, u64, uint64_t>; // 128-bit hash, size
+
+	/**
+	 * CityHash128 has no streaming form, the content is hashed in chunks chained through the seed.
+	 */
+	class ContentHasher
+	{
+	public:
+		static constexpr uint64_t CHUNK_SIZE = 1024 * 1024;
+
+	public:
+		void update( const u8 *data, uint64_t size );
+		inline const uint128 &hash() const { return m_hash; }
+
+	private:
+		uint128 m_hash = { 0x9ae16a3b2f90404full, 0xc3a5c85c97cb3127ull };
+	};
+
+private:
+	/**
+	 * Returns true if the caller is the first one with the key and has to publish it.
+	 * Otherwise waits until the key is published and returns path of its file in existing.
+	 */
+	template< typename Key >
+	bool claim( Map<Key, Record> &records, const Key &key, String &existing );
+
+	template< typename Key >
+	void publish( Map<Key, Record> &records, const Key &key, const String &path );
+
+	bool link( const String &existing, const String &filePath, uint64_t size );
+
+	bool hash( File &input, ContentHasher &hasher );
+	bool writeHashed( const String &filePath, File &input, ContentHasher &hasher );
+	bool copy( const String &filePath, File &input );
+	UniquePtr<File> create( const String &filePath );
+
+	static Array<u8> &chunkBuffer();
+
+private:
+	SysFileSystem &m_destination;
+
+	std::mutex m_mutex;
+	std::condition_variable m_published;
+	Map<LocationKey, Record> m_locations;
+	Map<ContentKey, Record> m_contents;
+
+	std::atomic<u64> m_linkedFiles = { 0 };
+	std::atomic<u64> m_savedBytes = { 0 };
+};
+
+/* eof */
@@ -26,6 +26,152 @@
 
 #include "uberfilesystem.h"
 #include "sysfilesystem.h"
+#include "sysfs_file.h"
+
+#include <mutex>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/sendfile.h>
+#endif
+
+namespace
+{
+	/**
+	 * Buffers of File::view, reused so loaders do not allocate for every asset
+	 */
+	class ViewBufferPool
+	{
+	public:
+		static constexpr size_t MAX_BUFFERS = 8;
+		static constexpr size_t MAX_BUFFER_CAPACITY = 64 * 1024 * 1024;
+
+		SharedPtr<Array<u8>> acquire( size_t size )
+		{
+			Array<u8> *buffer = nullptr;
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if( !m_free.empty() )
+				{
+					buffer = m_free.back();
+					m_free.pop_back();
+				}
+			}
+			if( !buffer )
+			{
+				buffer = new Array<u8>();
+			}
+			buffer->resize( size );
+			return SharedPtr<Array<u8>>( buffer, [ this ]( Array<u8> *b ) { release( b ); } );
+		}
+
+	private:
+		void release( Array<u8> *buffer )
+		{
+			if( buffer->capacity() <= MAX_BUFFER_CAPACITY )
+			{
+				std::lock_guard<std::mutex> lock( m_mutex );
+				if( m_free.size() < MAX_BUFFERS )
+				{
+					m_free.push_back( buffer );
+					return;
+				}
+			}
+			delete buffer;
+		}
+
+	private:
+		std::mutex m_mutex;
+		Array<Array<u8> *> m_free;
+	};
+
+	ViewBufferPool *getViewBufferPool()
+	{
+		// never destroyed, views may be released during static destruction
+		static ViewBufferPool *const pool = new ViewBufferPool();
+		return pool;
+	}
+
+	const u8 c_emptyView[ 1 ] = { 0 };
+
+	/**
+	 * Copies the stored content of input into output inside the kernel, returns count of bytes copied.
+	 * Copies less than size when the kernel cannot copy between the files, the rest is then copied through a buffer.
+	 */
+	uint64_t copyStorage( File *const input, File *const output, uint64_t size )
+	{
+#ifdef __linux__
+		uint64_t inputOffset = 0;
+		SysFsFile *const source = dynamic_cast<SysFsFile *>( input->storage( &inputOffset ) );
+		SysFsFile *const target = dynamic_cast<SysFsFile *>( output );
+		if( !source || !target || size == 0 )
+		{
+			return 0;
+		}
+
+		target->flush();
+		const int in = source->descriptor();
+		const int out = target->descriptor();
+		const uint64_t outputStart = target->tell();
+
+		loff_t inOffset = static_cast<loff_t>( inputOffset );
+		loff_t outOffset = static_cast<loff_t>( outputStart );
+		uint64_t copied = 0;
+
+		// copy_file_range may share extents on reflink capable filesystems, sendfile covers older kernels and cross device copies
+		bool useCopyRange = true;
+		while( copied < size )
+		{
+			const size_t chunk = static_cast<size_t>( std::min<uint64_t>( size - copied, 0x40000000 ) );
+			ssize_t result = -1;
+			if( useCopyRange )
+			{
+				result = ::copy_file_range( in, &inOffset, out, &outOffset, chunk, 0 );
+				if( result < 0 && errno != EINTR )
+				{
+					useCopyRange = false;
+					continue;
+				}
+			}
+			else
+			{
+				off_t sendOffset = static_cast<off_t>( inOffset );
+				if( ::lseek( out, static_cast<off_t>( outOffset ), SEEK_SET ) < 0 )
+				{
+					break;
+				}
+				result = ::sendfile( out, in, &sendOffset, chunk );
+				if( result > 0 )
+				{
+					inOffset += result;
+					outOffset += result;
+				}
+			}
+			if( result < 0 && errno == EINTR )
+			{
+				continue;
+			}
+			if( result <= 0 )
+			{
+				break;
+			}
+			copied += static_cast<uint64_t>( result );
+		}
+
+		target->seek( outputStart + copied, File::SeekSet );
+		return copied;
+#else
+		return 0;
+#endif
+	}
+} // namespace
+
+FileView::FileView( const u8 *data, size_t size, SharedPtr<const void> owner )
+	: m_data( data ? data : c_emptyView )
+	, m_size( size )
+	, m_owner( std::move( owner ) )
+{
+}
 
 File::File()
 {
@@ -269,6 +415,11 @@ bool File::blockRead(void *buffer, uint64_t offset, uint64_t size)
 	return read(buffer, 1, size) == size;
 }
 
+bool File::readAt( void *buffer, uint64_t offset, uint64_t size )
+{
+	return blockRead( buffer, offset, size );
+}
+
 bool File::blockWrite( const void *buffer, uint64_t size )
 {
 	return write( buffer, 1, size ) == size;
@@ -280,18 +431,77 @@ bool File::getContents( Array<u8> &buffer )
 	return blockRead( buffer.data(), 0, buffer.size() );
 }
 
+FileView File::view()
+{
+	const size_t bytes = static_cast<size_t>( size() );
+	SharedPtr<Array<u8>> buffer = getViewBufferPool()->acquire( bytes );
+	if( bytes != 0 && !blockRead( buffer->data(), 0, bytes ) )
+	{
+		return FileView();
+	}
+	const u8 *const data = buffer->data();
+	return FileView( data, bytes, std::move( buffer ) );
+}
+
+File *File::storage( uint64_t *offset )
+{
+	return nullptr;
+}
+
+void File::reserve( uint64_t size )
+{
+}
+
+bool File::discard( uint64_t count )
+{
+	u8 buffer[ 4096 ];
+	while( count > 0 )
+	{
+		const uint64_t bytes = std::min<uint64_t>( count, sizeof( buffer ) );
+		if( read( buffer, 1, bytes ) != bytes )
+		{
+			return false;
+		}
+		count -= bytes;
+	}
+	return true;
+}
+
 bool copyFile(File *const input, File *const output)
 {
-	input->rewind();
-	uint64_t toCopy = input->size();
+	const uint64_t size = input->size();
+	const uint64_t copied = copyStorage(input, output, size);
+	if (copied == size)
+	{
+		return true;
+	}
+
+	if (copied == 0)
+	{
+		input->rewind();
+	}
+	else
+	{
+		input->seek(copied, File::SeekSet);
+	}
+	uint64_t toCopy = size - copied;
+
+	// reused by every copy made on this thread
+	thread_local Array<u8> buffer;
 	const uint64_t bufferSize = 10 * 1024 * 1024;
-	uint8_t *buffer = new uint8_t[bufferSize];
-	for (uint64_t readed = 0; toCopy > 0 && (readed = input->read((char *)buffer, 1, std::min(bufferSize, toCopy))) != 0; toCopy -= readed)
+	if (buffer.size() < std::min(bufferSize, toCopy))
 	{
-		output->write(buffer, 1, readed);
+		buffer.resize(static_cast<size_t>(std::min(bufferSize, toCopy)));
 	}
-	delete[] buffer;
-	return true;
+
+	for (uint64_t readed = 0; toCopy > 0 && (readed = input->read(buffer.data(), 1, std::min<uint64_t>(buffer.size(), toCopy))) != 0; toCopy -= readed)
+	{
+		if (output->write(buffer.data(), 1, readed) != readed)
+		{
+			return false;
+		}
+	}
+	return toCopy == 0;
 }
 
 /* eof */
@@ -24,6 +24,27 @@
 
 class MetaStat;
 
+/**
+ * Read-only view of the whole content of a file.
+ * Points into the mapped archive or in-memory storage when possible, otherwise into a pooled buffer kept alive by the owner.
+ * Views into archives and in-memory filesystems are valid while the filesystem is mounted and the file is not rewritten.
+ */
+class FileView
+{
+public:
+	FileView() = default;
+	FileView( const u8 *data, size_t size, SharedPtr<const void> owner = nullptr );
+
+	inline const u8 *data() const { return m_data; }
+	inline size_t size() const { return m_size; }
+	inline explicit operator bool() const { return m_data != nullptr; }
+
+private:
+	const u8 *m_data = nullptr;
+	size_t m_size = 0;
+	SharedPtr<const void> m_owner;
+};
+
 class File
 {
 public:
@@ -51,12 +72,44 @@ public:
 	virtual void flush() = 0;
     virtual void mstat( MetaStat *result ) = 0;
 
+	/**
+	 * Reads exactly size bytes at the given offset without using the file cursor (pread semantics).
+	 * Implementations backed by a real file may be called from several threads at once.
+	 * The default implementation falls back to blockRead and is not thread-safe.
+	 */
+	virtual bool readAt( void *buffer, uint64_t offset, uint64_t size );
+
 	bool blockRead(void *buffer, uint64_t offset, uint64_t size);
 
 	bool blockWrite( const void *buffer, uint64_t size );
 
 	bool getContents( Array<u8> &buffer );
 
+	/**
+	 * Returns view of the whole file, invalid view on failure.
+	 * The default implementation reads the file into a pooled buffer.
+	 */
+	virtual FileView view();
+
+	/**
+	 * Returns the system file holding the content stored verbatim and sets offset to the start of the content in it.
+	 * Returns nullptr when the content is compressed or not backed by a system file.
+	 */
+	virtual File *storage( uint64_t *offset );
+
+	/**
+	 * Hint that the file is going to be written up to size bytes, lets in-memory files allocate their content once.
+	 */
+	virtual void reserve( uint64_t size );
+
+protected:
+	/**
+	 * Reads and drops count bytes, lets compressed streams seek forward.
+	 */
+	bool discard( uint64_t count );
+
+public:
+
 	File &operator<<(bool val);
 	File &operator<<(short val);
 	File &operator<<(unsigned short val);
@@ -0,0 +1,170 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/file_mapping.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "file_mapping.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+FileMapping::FileMapping()
+{
+}
+
+FileMapping::~FileMapping()
+{
+	unmap();
+}
+
+bool FileMapping::map( const String &filepath )
+{
+	unmap();
+
+#ifdef _WIN32
+	m_file = ::CreateFileA( filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if( m_file == INVALID_HANDLE_VALUE )
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if( !::GetFileSizeEx( m_file, &fileSize ) || fileSize.QuadPart == 0 || uint64_t( fileSize.QuadPart ) > uint64_t( SIZE_MAX ) )
+	{
+		unmap();
+		return false;
+	}
+
+	m_mapping = ::CreateFileMappingA( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if( m_mapping == nullptr )
+	{
+		unmap();
+		return false;
+	}
+
+	m_data = static_cast<const u8 *>( ::MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 ) );
+	if( m_data == nullptr )
+	{
+		unmap();
+		return false;
+	}
+	m_size = static_cast<uint64_t>( fileSize.QuadPart );
+#else
+	const int fd = ::open( filepath.c_str(), O_RDONLY );
+	if( fd < 0 )
+	{
+		return false;
+	}
+
+	struct stat st;
+	if( ::fstat( fd, &st ) != 0 || st.st_size <= 0 || uint64_t( st.st_size ) > uint64_t( SIZE_MAX ) )
+	{
+		::close( fd );
+		return false;
+	}
+
+	void *const data = ::mmap( nullptr, static_cast<size_t>( st.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+	::close( fd ); // mapping holds its own reference to the file
+	if( data == MAP_FAILED )
+	{
+		return false;
+	}
+
+	m_data = static_cast<const u8 *>( data );
+	m_size = static_cast<uint64_t>( st.st_size );
+#endif
+	return true;
+}
+
+void FileMapping::unmap()
+{
+#ifdef _WIN32
+	if( m_data )
+	{
+		::UnmapViewOfFile( m_data );
+	}
+	if( m_mapping )
+	{
+		::CloseHandle( m_mapping );
+		m_mapping = nullptr;
+	}
+	if( m_file != INVALID_HANDLE_VALUE )
+	{
+		::CloseHandle( m_file );
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if( m_data )
+	{
+		::munmap( const_cast<u8 *>( m_data ), static_cast<size_t>( m_size ) );
+	}
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+const u8 *FileMapping::at( uint64_t offset, uint64_t size ) const
+{
+	if( !m_data || offset > m_size || size > m_size - offset )
+	{
+		return nullptr;
+	}
+	return m_data + offset;
+}
+
+bool FileMapping::read( void *buffer, uint64_t offset, uint64_t size ) const
+{
+	const u8 *const source = at( offset, size );
+	if( !source )
+	{
+		return false;
+	}
+	memcpy( buffer, source, static_cast<size_t>( size ) );
+	return true;
+}
+
+void FileMapping::willNeed( uint64_t offset, uint64_t size ) const
+{
+	if( !at( offset, size ) || size == 0 )
+	{
+		return;
+	}
+
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<u8 *>( m_data + offset );
+	range.NumberOfBytes = static_cast<SIZE_T>( size );
+	::PrefetchVirtualMemory( ::GetCurrentProcess(), 1, &range, 0 );
+#endif
+#else
+	// madvise requires page aligned address
+	const uint64_t pageSize = static_cast<uint64_t>( ::sysconf( _SC_PAGESIZE ) );
+	const uint64_t begin = offset & ~( pageSize - 1 );
+	::madvise( const_cast<u8 *>( m_data + begin ), static_cast<size_t>( offset + size - begin ), MADV_WILLNEED );
+#endif
+}
+
+/* eof */
@@ -0,0 +1,69 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/file_mapping.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+/**
+ * Read-only view of a whole file mapped into the address space.
+ * Reads from the view are position-independent and may be issued from any thread.
+ */
+class FileMapping
+{
+public:
+	FileMapping();
+	FileMapping( const FileMapping & ) = delete;
+	FileMapping( FileMapping && ) = delete;
+	~FileMapping();
+
+	FileMapping &operator=( const FileMapping & ) = delete;
+	FileMapping &operator=( FileMapping && ) = delete;
+
+	bool map( const String &filepath );
+	void unmap();
+
+	inline bool isMapped() const { return m_data != nullptr; }
+	inline const u8 *data() const { return m_data; }
+	inline uint64_t size() const { return m_size; }
+
+	/**
+	 * Returns pointer to the requested range or nullptr when the range is out of the mapped view.
+	 */
+	const u8 *at( uint64_t offset, uint64_t size ) const;
+
+	bool read( void *buffer, uint64_t offset, uint64_t size ) const;
+
+	/**
+	 * Advises the system to read the range of the view ahead.
+	 */
+	void willNeed( uint64_t offset, uint64_t size ) const;
+
+private:
+	const u8 *m_data = nullptr;
+	uint64_t m_size = 0;
+
+#ifdef _WIN32
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#endif
+};
+
+/* eof */
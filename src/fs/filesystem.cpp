@@ -45,6 +45,42 @@ UniquePtr<File> FileSystem::openForReadingWithPlainMeta( const String &filename,
 	return nullptr;
 }
 
+FileView FileSystem::openView( const String &filename )
+{
+	UniquePtr<File> file = open( filename, FileSystem::read | FileSystem::binary );
+	return file ? file->view() : FileView();
+}
+
+bool FileSystem::enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f )
+{
+	return false;
+}
+
+UniquePtr<File> FileSystem::openIndexed( EntryHandle entry, const String &filePath, FsOpenMode mode )
+{
+	return open( filePath, mode );
+}
+
+bool FileSystem::mstatIndexed( EntryHandle entry, MetaStat *result, const String &path )
+{
+	return mstat( result, path );
+}
+
+bool FileSystem::locateIndexed( EntryHandle entry, const String &path, Location *result )
+{
+	return locate( path, result );
+}
+
+bool FileSystem::locate( const String &path, Location *result )
+{
+	return false;
+}
+
+bool FileSystem::prefetch( const Location &location, Array<u8> &staging )
+{
+	return false;
+}
+
 SysFileSystem *getSFS()
 {
 	static SysFileSystem fs("");
@@ -57,6 +93,21 @@ UberFileSystem *getUFS()
 	return &fs;
 }
 
+namespace
+{
+	FileSystem *s_outputFileSystem = nullptr;
+} // namespace
+
+FileSystem *getOutputFS()
+{
+	return s_outputFileSystem ? s_outputFileSystem : getSFS();
+}
+
+void setOutputFS(FileSystem *fs)
+{
+	s_outputFileSystem = fs;
+}
+
 FileSystem *ufsMount(const String &root, scs_bool readOnly, int priority)
 {
 	if (getSFS()->dirExists(root))
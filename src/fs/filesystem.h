@@ -26,12 +26,25 @@
 #include "structs/fs.h"
 
 class MetaStat;
+class FileView;
 
 class FileSystem
 {
 public:
 	class Entry;
 
+	/**
+	 * Position of file data in the file backing the filesystem
+	 */
+	struct Location
+	{
+		FileSystem *m_filesystem = nullptr;
+		uint64_t m_offset = 0;
+		uint64_t m_size = 0; // stored (compressed) size
+		bool m_stored = false; // data is not compressed, copyFile may copy it without reading
+		bool m_staged = false; // reader of the file takes data staged by Prefetcher
+	};
+
 	enum FsOpenMode
 	{
 		OpenModeNone = 0
@@ -77,6 +90,42 @@ public:
 
 	virtual UniquePtr<File> openForReadingWithPlainMeta( const String &filename, const prism::fs_meta_plain_t &plainMetaValues, bool *outFileExists = nullptr );
 
+	/**
+	 * Opens the file for reading and returns view of its whole content, invalid view on failure.
+	 */
+	FileView openView( const String &filename );
+
+	/**
+	 * Handle of an entry given out by enumerateEntryHashes, its meaning is up to the filesystem (e.g. index in the entry table).
+	 */
+	using EntryHandle = u64;
+
+	/**
+	 * Calls f for every entry with city hash of its path (without leading slash) and handle of the entry.
+	 * Returns false if entries cannot be addressed by such hash (e.g. salted archives, in-memory filesystems).
+	 */
+	virtual bool enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f );
+
+	/**
+	 * Same as open, mstat and locate, but for an entry given by enumerateEntryHashes, so the path is not looked up again.
+	 * The path only names the result. By default the path is looked up.
+	 */
+	virtual UniquePtr<File> openIndexed( EntryHandle entry, const String &filePath, FsOpenMode mode );
+	virtual bool mstatIndexed( EntryHandle entry, MetaStat *result, const String &path );
+	virtual bool locateIndexed( EntryHandle entry, const String &path, Location *result );
+
+	/**
+	 * Returns false if the file does not exist or its data has no position in a backing file (e.g. files on disk).
+	 */
+	virtual bool locate( const String &path, Location *result );
+
+	/**
+	 * Reads stored data of the located file into staging ahead of its use, see Prefetcher.
+	 * When the data is directly accessible (mapped archive) the system is only advised to read it and staging stays empty.
+	 * Returns false if the filesystem cannot do it.
+	 */
+	virtual bool prefetch( const Location &location, Array<u8> &staging );
+
 	inline String root( const String &path )
 	{
 		const String rootPath = root();
@@ -173,6 +222,12 @@ constexpr FileSystem::FsOpenMode operator|(const FileSystem::FsOpenMode t, const
 SysFileSystem *getSFS();
 UberFileSystem *getUFS();
 
+/**
+ * Filesystem the converted files are written to, system filesystem unless an archive output is set.
+ */
+FileSystem *getOutputFS();
+void setOutputFS(FileSystem *fs);
+
 FileSystem *ufsMount(const String &root, scs_bool readOnly, int priority);
 void ufsUnmount(FileSystem *fs);
 
@@ -0,0 +1,129 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/hash_index.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "hash_index.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	inline void prefetch( const void *address )
+	{
+#if defined( __GNUC__ ) || defined( __clang__ )
+		__builtin_prefetch( address );
+#elif defined( _M_X64 ) || defined( _M_IX86 )
+		_mm_prefetch( static_cast<const char *>( address ), _MM_HINT_T0 );
+#else
+		(void)address;
+#endif
+	}
+} // namespace
+
+void HashIndex::reset( size_t count )
+{
+	// load factor at most one half
+	size_t capacity = 16;
+	while( capacity < count * 2 )
+	{
+		capacity <<= 1;
+	}
+
+	m_slots.storage().assign( capacity, Slot{ 0, NOT_FOUND, 0 } );
+	m_mask = capacity - 1;
+}
+
+void HashIndex::insert( u64 hash, u32 index )
+{
+	Array<Slot> &slots = m_slots.storage();
+	for( size_t slot = static_cast<size_t>( hash ) & m_mask;; slot = ( slot + 1 ) & m_mask )
+	{
+		if( slots[ slot ].m_index == NOT_FOUND )
+		{
+			slots[ slot ] = Slot{ hash, index, 0 };
+			return;
+		}
+		if( slots[ slot ].m_hash == hash ) // keep the first one
+		{
+			return;
+		}
+	}
+}
+
+u32 HashIndex::find( u64 hash ) const
+{
+	if( m_slots.empty() )
+	{
+		return NOT_FOUND;
+	}
+
+	// city hash is well mixed, low bits are used directly
+	for( size_t slot = static_cast<size_t>( hash ) & m_mask;; slot = ( slot + 1 ) & m_mask )
+	{
+		const Slot &s = m_slots[ slot ];
+		if( s.m_index == NOT_FOUND || s.m_hash == hash )
+		{
+			return s.m_index;
+		}
+	}
+}
+
+void HashIndex::find( const u64 *hashes, u32 *indices, size_t count ) const
+{
+	if( m_slots.empty() )
+	{
+		std::fill( indices, indices + count, NOT_FOUND );
+		return;
+	}
+
+	constexpr size_t BATCH = 16;
+	for( size_t first = 0; first < count; first += BATCH )
+	{
+		const size_t last = std::min( first + BATCH, count );
+		for( size_t i = first; i < last; ++i )
+		{
+			prefetch( &m_slots[ static_cast<size_t>( hashes[ i ] ) & m_mask ] );
+		}
+		for( size_t i = first; i < last; ++i )
+		{
+			indices[ i ] = find( hashes[ i ] );
+		}
+	}
+}
+
+bool HashIndex::assign( const u8 *section, uint64_t size )
+{
+	// capacity is a power of two, probing relies on the mask
+	const uint64_t capacity = size / sizeof( Slot );
+	if( capacity == 0 || ( capacity & ( capacity - 1 ) ) != 0 || !m_slots.assign( section, size ) )
+	{
+		return false;
+	}
+
+	m_mask = static_cast<size_t>( capacity - 1 );
+	return true;
+}
+
+/* eof */
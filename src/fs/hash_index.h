@@ -0,0 +1,78 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/hash_index.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include "cached_array.h"
+
+/**
+ * Open addressing table mapping path hashes to indices of archive entries.
+ * Built once at mount, lookups touch usually a single cache line instead of
+ * ~log2(n) scattered probes of binary search over the entry table.
+ */
+class HashIndex
+{
+public:
+	static constexpr u32 NOT_FOUND = 0xFFFFFFFF;
+
+	template< typename Entries >
+	void build( const Entries &entries )
+	{
+		reset( entries.size() );
+		for( size_t i = 0; i < entries.size(); ++i )
+		{
+			insert( entries[ i ].m_hash, static_cast<u32>( i ) );
+		}
+	}
+
+	u32 find( u64 hash ) const;
+
+	/**
+	 * Looks up many hashes at once, slots of a whole batch are prefetched before probing
+	 */
+	void find( const u64 *hashes, u32 *indices, size_t count ) const;
+
+	/**
+	 * Uses slots stored in a mapped IndexCache section instead of building them, returns false when the section is malformed.
+	 */
+	bool assign( const u8 *section, uint64_t size );
+
+	inline const void *data() const { return m_slots.data(); }
+	inline uint64_t byteSize() const { return m_slots.byteSize(); }
+
+private:
+	void reset( size_t count );
+	void insert( u64 hash, u32 index );
+
+private:
+	struct Slot
+	{
+		u64 m_hash;
+		u32 m_index;
+		u32 m_reserved; // keeps stored slots free of undefined padding
+	};
+
+	CachedArray<Slot> m_slots;
+	size_t m_mask = 0;
+};
+
+/* eof */
@@ -27,6 +27,8 @@
 #include "sysfilesystem.h"
 #include "file.h"
 #include "hashfs_file.h"
+#include "content_cache.h"
+#include "prefetcher.h"
 
 #include <utils/string_tokenizer.h>
 
@@ -41,11 +43,16 @@ HashFileSystem::HashFileSystem(const String &root)
 		error("hashfs", root, "Unable to open root file");
 		return;
 	}
-	readHashFS();
+	if (readHashFS())
+	{
+		m_entryIndex.build(m_entries);
+	}
 }
 
 HashFileSystem::~HashFileSystem()
 {
+	getContentCache()->remove(this);
+	getPrefetcher()->remove(this);
 }
 
 String HashFileSystem::root() const
@@ -68,12 +75,30 @@ UniquePtr<File> HashFileSystem::open( const String &filename, FsOpenMode mode, b
 
 	if( outFileExists ) *outFileExists = true;
 
+	return openEntry( filename, entry );
+}
+
+UniquePtr<File> HashFileSystem::openIndexed( EntryHandle entry, const String &filePath, FsOpenMode mode )
+{
+	return openEntry( filePath, &m_entries[ static_cast< size_t >( entry ) ] );
+}
+
+UniquePtr<File> HashFileSystem::openEntry( const String &filename, prism::hashfs_entry_t *entry )
+{
 	if( entry->m_flags & prism::HASHFS_ENCRYPTED )
 	{
 		error( "hashfs", filename, "Encrypted files are not supported!" );
 		return nullptr;
 	}
 
+	if( entry->m_flags & prism::HASHFS_COMPRESSED )
+	{
+		if( ContentCache::Content content = getContentCache()->find( this, entry->m_hash, entry->m_offset ) )
+		{
+			return std::make_unique<CachedFile>( filename, this, std::move( content ) );
+		}
+	}
+
 	return std::make_unique<HashFsFile>( filename, this, entry );
 }
 
@@ -171,10 +196,26 @@ auto HashFileSystem::readDir(const String &path, bool absolutePaths, bool recurs
 	buffer[size] = '\0';
 	String data = buffer.get();
 
-	auto result = std::make_unique<List<Entry>>();
-
+	Array<String> lines;
+	Array<String> filePaths;
 	StringTokenizer tokenizer(data, "\n");
 	for (String line; tokenizer.getNext(&line);)
+	{
+		if (line[0] != '*')
+		{
+			filePaths.push_back(removeSlashAtEnd(dirpath) + "/" + line.c_str());
+		}
+		lines.push_back(std::move(line));
+	}
+
+	// entries of all files are looked up together
+	Array<hashfs_entry_t *> fileEntries;
+	findEntries(filePaths, fileEntries);
+
+	auto result = std::make_unique<List<Entry>>();
+
+	size_t fileIndex = 0;
+	for (const String &line : lines)
 	{
 		if (line[0] == '*') // directory
 		{
@@ -211,7 +252,7 @@ auto HashFileSystem::readDir(const String &path, bool absolutePaths, bool recurs
 			}
 
 			bool encrypted = false;
-			prism::hashfs_entry_t *const entry = findEntry(removeSlashAtEnd(dirpath) + "/" + line.c_str());
+			prism::hashfs_entry_t *const entry = fileEntries[fileIndex++];
 			if (entry)
 			{
 				encrypted = !!(entry->m_flags & HASHFS_ENCRYPTED);
@@ -234,16 +275,67 @@ bool HashFileSystem::mstat( MetaStat *result, const String &path )
 	else return false;
 }
 
+bool HashFileSystem::mstatIndexed( EntryHandle entry, MetaStat *result, const String &path )
+{
+	result->m_filesystem = this;
+	return true;
+}
+
+bool HashFileSystem::locate(const String &path, Location *result)
+{
+	const prism::hashfs_entry_t *const entry = findEntry(path);
+	if (!entry)
+	{
+		return false;
+	}
+	return locateEntry(entry, result);
+}
+
+bool HashFileSystem::locateIndexed( EntryHandle entry, const String &path, Location *result )
+{
+	return locateEntry( &m_entries[ static_cast< size_t >( entry ) ], result );
+}
+
+bool HashFileSystem::locateEntry(const prism::hashfs_entry_t *entry, Location *result)
+{
+	result->m_filesystem = this;
+	result->m_offset = entry->m_offset;
+	result->m_size = entry->m_compressed_size;
+	result->m_stored = !(entry->m_flags & prism::HASHFS_COMPRESSED);
+	result->m_staged = true;
+	return true;
+}
+
+bool HashFileSystem::prefetch(const Location &location, Array<u8> &staging)
+{
+	staging.resize(static_cast<size_t>(location.m_size));
+	return ioRead(staging.data(), location.m_size, location.m_offset);
+}
+
+bool HashFileSystem::enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f )
+{
+	if( m_header.m_salt != 0 )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < m_entries.size(); ++i )
+	{
+		f( m_entries[ i ].m_hash, !!( m_entries[ i ].m_flags & prism::HASHFS_DIR ), i );
+	}
+	return true;
+}
+
 bool HashFileSystem::ioRead(void *const buffer, uint64_t bytes, uint64_t offset)
 {
-	return m_root->blockRead(buffer, offset, bytes);
+	return m_root->readAt(buffer, offset, bytes);
 }
 
 bool HashFileSystem::readHashFS()
 {
 	using namespace prism;
 
-	if (!m_root->blockRead(&m_header, 0, sizeof(hashfs_header_t)))
+	if (!ioRead(&m_header, sizeof(hashfs_header_t), 0))
 	{
 		error("hashfs", m_rootFilename, "Failed to read header!");
 		return false;
@@ -268,7 +360,7 @@ bool HashFileSystem::readHashFS()
 	}
 
 	m_entries.resize(m_header.m_entries_count);
-	if (!m_root->blockRead(m_entries.data(), m_header.m_start_offset, m_header.m_entries_count * sizeof(hashfs_entry_t)))
+	if (!ioRead(m_entries.data(), m_header.m_entries_count * sizeof(hashfs_entry_t), m_header.m_start_offset))
 	{
 		error("hasfs", m_rootFilename, "Failed to read entries!");
 		return false;
@@ -277,47 +369,43 @@ bool HashFileSystem::readHashFS()
 	return true;
 }
 
-prism::hashfs_entry_t *HashFileSystem::findEntry(const String &path)
+u64 HashFileSystem::hashPath(const String &path) const
 {
-	using namespace prism;
+	if (m_header.m_salt != 0)
+	{
+		const String pathToFind = fmt::sprintf("%u%s", m_header.m_salt, (path.c_str() + 1));
+		return prism::city_hash_64(pathToFind.c_str(), pathToFind.length());
+	}
+	return path.empty() ? prism::city_hash_64("", 0) : prism::city_hash_64(path.c_str() + 1, path.length() - 1);
+}
 
+prism::hashfs_entry_t *HashFileSystem::findEntry(const String &path)
+{
 	if (m_entries.empty())
 	{
 		return nullptr;
 	}
 
-	String pathToFind;
-	if (m_header.m_salt != 0)
-	{
-		pathToFind = fmt::sprintf("%u%s", m_header.m_salt, (path.c_str() + 1));
-	}
-	else
+	const u32 index = m_entryIndex.find(hashPath(path));
+	return index != HashIndex::NOT_FOUND ? &m_entries[index] : nullptr;
+}
+
+void HashFileSystem::findEntries(const Array<String> &paths, Array<prism::hashfs_entry_t *> &result)
+{
+	Array<u64> hashes(paths.size());
+	for (size_t i = 0; i < paths.size(); ++i)
 	{
-		pathToFind = path.c_str() + 1;
+		hashes[i] = hashPath(paths[i]);
 	}
 
-	const u64 hash = city_hash_64(pathToFind.c_str(), pathToFind.length());
+	Array<u32> indices(paths.size());
+	m_entryIndex.find(hashes.data(), indices.data(), indices.size());
 
-	for (s64 index, l = 0, r = m_entries.size() - 1; l <= r;) // binary search
+	result.resize(paths.size());
+	for (size_t i = 0; i < paths.size(); ++i)
 	{
-		index = l + (r - l) / 2;
-
-		if (m_entries[static_cast<size_t>(index)].m_hash == hash)
-		{
-			return &m_entries[static_cast<size_t>(index)];
-		}
-
-		if (m_entries[static_cast<size_t>(index)].m_hash < hash)
-		{
-			l = index + 1;
-		}
-		else
-		{
-			r = index - 1;
-		}
+		result[i] = indices[i] != HashIndex::NOT_FOUND ? &m_entries[indices[i]] : nullptr;
 	}
-
-	return nullptr;
 }
 
 /* eof */
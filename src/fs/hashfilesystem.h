@@ -23,6 +23,7 @@
 #pragma once
 
 #include "filesystem.h"
+#include "hash_index.h"
 
 #include <structs/hashfs.h>
 
@@ -47,8 +48,15 @@ public:
 	virtual bool dirExists(const String &dirpath) override;
 	virtual UniquePtr<List<Entry>> readDir(const String &path, bool absolutePaths, bool recursive) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
+	virtual bool enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f ) override;
+	virtual UniquePtr<File> openIndexed( EntryHandle entry, const String &filePath, FsOpenMode mode ) override;
+	virtual bool mstatIndexed( EntryHandle entry, MetaStat *result, const String &path ) override;
+	virtual bool locateIndexed( EntryHandle entry, const String &path, Location *result ) override;
+	virtual bool locate( const String &path, Location *result ) override;
+	virtual bool prefetch( const Location &location, Array<u8> &staging ) override;
 
 	bool ioRead(void *const buffer, uint64_t bytes, uint64_t offset);
+	inline File *device() const { return m_root.get(); }
 
 private:
 	String m_rootFilename;
@@ -56,10 +64,15 @@ private:
 
 	prism::hashfs_header_t m_header;
 	Array<prism::hashfs_entry_t> m_entries;
+	HashIndex m_entryIndex;
 
 private:
 	bool readHashFS();
+	u64 hashPath(const String &path) const;
 	prism::hashfs_entry_t *findEntry(const String &path);
+	UniquePtr<File> openEntry(const String &filename, prism::hashfs_entry_t *entry);
+	bool locateEntry(const prism::hashfs_entry_t *entry, Location *result);
+	void findEntries(const Array<String> &paths, Array<prism::hashfs_entry_t *> &result);
 };
 
 /* eof */
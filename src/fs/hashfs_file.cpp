@@ -26,6 +26,11 @@
 
 #include "hashfilesystem.h"
 
+#include "content_cache.h"
+#include "prefetcher.h"
+
+#include <utils/compression.h>
+
 HashFsFile::HashFsFile(const String &filepath, HashFileSystem *filesystem, const prism::hashfs_entry_t *header)
 	: m_filepath(filepath)
 	, m_filesystem(filesystem)
@@ -66,14 +71,19 @@ uint64_t HashFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCo
 			return 0;
 		}
 
-		if (m_filesystem->ioRead(buffer, elementSize * elementCount, m_header->m_offset + m_position))
+		const uint64_t result = std::min(elementSize * elementCount, m_header->m_size - m_position);
+
+		Array<u8> staged;
+		if (m_position == 0 && result == m_header->m_size && getPrefetcher()->take(m_filesystem, m_header->m_offset, staged) && staged.size() == m_header->m_size)
 		{
-			uint64_t result = std::min(elementSize * elementCount, m_header->m_size - m_position);
-			m_position += elementSize * elementCount;
-			if (m_position > m_header->m_size)
-			{
-				m_position = m_header->m_size;
-			}
+			memcpy(buffer, staged.data(), static_cast<size_t>(result));
+			m_position += result;
+			return result;
+		}
+
+		if (m_filesystem->ioRead(buffer, result, m_header->m_offset + m_position))
+		{
+			m_position += result;
 			return result;
 		}
 		else
@@ -83,6 +93,11 @@ uint64_t HashFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCo
 	}
 	else
 	{
+		if (m_position == 0 && elementSize * elementCount >= m_header->m_size && m_header->m_size != 0)
+		{
+			return inflateWhole(buffer);
+		}
+
 		const uint64_t chunk = 1024 * 4;
 		uint8_t inbuffer[chunk];
 		uint64_t bufferOffset = 0;
@@ -121,6 +136,7 @@ uint64_t HashFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCo
 			assert(bufferOffset <= (elementSize * elementCount));
 			m_position += (bytes - m_stream.avail_in);
 		}
+		m_inflated += bufferOffset;
 		return bufferOffset;
 	}
 }
@@ -134,16 +150,15 @@ bool HashFsFile::seek(uint64_t offset, Attrib attr)
 {
 	if (m_header->m_flags & prism::HASHFS_COMPRESSED)
 	{
-		if (offset == 0 && attr == SeekSet)
+		const uint64_t target = attr == SeekSet ? offset : attr == SeekCur ? m_inflated + offset : size() - offset;
+		if (target < m_inflated || (target == 0 && m_position != 0))
 		{
-			if (m_position != 0)
-			{
-				inflateDestroy();
-				inflateInitialize();
-			}
-			return true;
+			inflateDestroy();
+			inflateInitialize();
+			m_position = 0;
+			m_inflated = 0;
 		}
-		return false; // random access is not allowed
+		return discard(target - m_inflated); // zlib stream can only be decoded forward
 	}
 	else
 	{
@@ -170,7 +185,7 @@ void HashFsFile::rewind()
 
 uint64_t HashFsFile::tell() const
 {
-	return m_position;
+	return (m_header->m_flags & prism::HASHFS_COMPRESSED) ? m_inflated : m_position;
 }
 
 void HashFsFile::flush()
@@ -181,6 +196,42 @@ void HashFsFile::mstat( MetaStat *result )
 {
 }
 
+File *HashFsFile::storage(uint64_t *offset)
+{
+	if (m_header->m_flags & prism::HASHFS_COMPRESSED)
+	{
+		return nullptr;
+	}
+	*offset = m_header->m_offset;
+	return m_filesystem->device();
+}
+
+uint64_t HashFsFile::inflateWhole(void *buffer)
+{
+	Array<uint8_t> compressed;
+	if (!getPrefetcher()->take(m_filesystem, m_header->m_offset, compressed) || compressed.size() != m_header->m_compressed_size)
+	{
+		compressed.resize(m_header->m_compressed_size);
+		if (!m_filesystem->ioRead(compressed.data(), compressed.size(), m_header->m_offset))
+		{
+			error("hashfs", m_filepath, "Unable to read from filesystem file");
+			return 0;
+		}
+	}
+
+	if (!unCompressWhole_zlib(buffer, m_header->m_size, compressed.data(), compressed.size()))
+	{
+		error("hashfs", m_filepath, "Unable to decompress file");
+		return 0;
+	}
+
+	getContentCache()->insert(m_filesystem, m_header->m_hash, m_header->m_offset, buffer, m_header->m_size);
+
+	m_position = m_header->m_compressed_size;
+	m_inflated = m_header->m_size;
+	return m_header->m_size;
+}
+
 void HashFsFile::inflateInitialize()
 {
 	m_stream.zalloc = Z_NULL;
@@ -45,18 +45,21 @@ public:
 	virtual uint64_t tell() const override;
 	virtual void flush() override;
 	virtual void mstat( MetaStat *result ) override;
+	virtual File *storage( uint64_t *offset ) override;
 
 private:
 	String			m_filepath;
 	HashFileSystem *m_filesystem;
 	z_stream		m_stream;
 	uint64_t		m_position;
+	uint64_t		m_inflated = 0; // position in decompressed data
 
 	const prism::hashfs_entry_t *m_header;
 
 private:
 	void inflateInitialize();
 	void inflateDestroy();
+	uint64_t inflateWhole(void *buffer);
 
 	friend class HashFileSystem;
 };
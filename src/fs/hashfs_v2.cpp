@@ -27,27 +27,44 @@
 #include "hashfs_v2_file.h"
 #include "sysfilesystem.h"
 #include "file.h"
+#include "index_cache.h"
+#include "content_cache.h"
+#include "prefetcher.h"
 
 #include "utils/string_tokenizer.h"
 #include "utils/compression.h"
 #include "utils/token.h"
 
+#include <deque>
+
+bool HashFsV2::s_memoryMappingEnabled = true;
+
 HashFsV2::HashFsV2( const String &root )
 {
 	m_rootFilename = root;
+
+	// the file stays open next to the mapping, stored entries are copied from it by the kernel
 	m_root = getSFS()->open( root, FileSystem::read | FileSystem::binary );
 	if( !m_root )
 	{
 		error( "hashfs_v2", root, "Unable to open root file" );
 		return;
 	}
+	if( memoryMappingEnabled() )
+	{
+		m_mapping.map( getSFS()->root() + root );
+	}
 	if( !readHashFS() )
 	{
 		assert( false );
 	}
 }
 
-HashFsV2::~HashFsV2() = default;
+HashFsV2::~HashFsV2()
+{
+	getContentCache()->remove( this );
+	getPrefetcher()->remove( this );
+}
 
 String HashFsV2::root() const
 {
@@ -61,7 +78,7 @@ String HashFsV2::name() const
 
 UniquePtr<File> HashFsV2::open( const String &filename, FsOpenMode mode, bool *outFileExists )
 {
-	prism::hashfs_v2_entry_t *const entry = findEntry( filename );
+	const prism::hashfs_v2_entry_t *const entry = findEntry( filename );
 	if( entry == nullptr )
 	{
 		return nullptr;
@@ -69,6 +86,16 @@ UniquePtr<File> HashFsV2::open( const String &filename, FsOpenMode mode, bool *o
 
 	if( outFileExists ) *outFileExists = true;
 
+	return openEntry( filename, entry );
+}
+
+UniquePtr<File> HashFsV2::openIndexed( EntryHandle entry, const String &filePath, FsOpenMode mode )
+{
+	return openEntry( filePath, &m_entryTable[ static_cast< size_t >( entry ) ] );
+}
+
+UniquePtr<File> HashFsV2::openEntry( const String &filename, const prism::hashfs_v2_entry_t *entry )
+{
 	//if (entry->m_flags & HASHFS_ENCRYPTED)
 	//{
 	//	error("hashfs", filename, "Encrypted files are not supported!");
@@ -86,7 +113,7 @@ UniquePtr<File> HashFsV2::open( const String &filename, FsOpenMode mode, bool *o
 	prism::fs_meta_plain_t plainMetaValues = { 0 };
 	prism::hashfs_v2_meta_plain_get_value( plainMetadata, plainMetaValues );
 
-	return std::make_unique<HashFsV2File>( filename, this, entry, plainMetaValues );
+	return openEntry( filename, entry, plainMetaValues );
 }
 
 bool HashFsV2::remove( const String &filePath )
@@ -111,7 +138,7 @@ bool HashFsV2::exists( const String &filename )
 		return false;
 	}
 
-	prism::hashfs_v2_entry_t *const entry = findEntry( filename );
+	const prism::hashfs_v2_entry_t *const entry = findEntry( filename );
 	if( !entry )
 	{
 		return false;
@@ -132,7 +159,7 @@ bool HashFsV2::dirExists( const String &dirpath )
 		return false;
 	}
 
-	prism::hashfs_v2_entry_t *const entry = findEntry( dirpath.size() != 1 ? removeSlashAtEnd( dirpath ) : dirpath );
+	const prism::hashfs_v2_entry_t *const entry = findEntry( dirpath.size() != 1 ? removeSlashAtEnd( dirpath ) : dirpath );
 	if( !entry )
 	{
 		return false;
@@ -156,7 +183,7 @@ auto HashFsV2::readDir( const String &path, bool absolutePaths, bool recursive )
 
 	String dirpath = path.size() != 1 ? removeSlashAtEnd( path ) : path;
 
-	prism::hashfs_v2_entry_t *const entry = findEntry( dirpath );
+	const prism::hashfs_v2_entry_t *const entry = findEntry( dirpath );
 	if( entry == nullptr )
 	{
 		error_f( "hashfs_v2", m_rootFilename, "Failed to open dirlist entry (%s)!", path );
@@ -169,90 +196,137 @@ auto HashFsV2::readDir( const String &path, bool absolutePaths, bool recursive )
 		return nullptr;
 	}
 
+	std::lock_guard<std::mutex> lock( m_treeMutex );
+
+	if( m_treeNodes.empty() && findEntry( "/" ) )
+	{
+		buildTree( "/" );
+	}
+
+	u32 node = m_treeDirectories.empty() ? TreeNode::NO_NODE : m_treeDirectories[ static_cast<size_t>( entry - m_entryTable.data() ) ];
+	if( node == TreeNode::NO_NODE ) // not reachable from the root
+	{
+		node = buildTree( dirpath );
+	}
+
+	auto result = std::make_unique<List<Entry>>();
+	String prefix = absolutePaths ? removeSlashAtEnd( dirpath ) + "/" : String();
+	listTree( node, prefix, recursive, *result );
+	return result;
+}
+
+bool HashFsV2::readDirectoryListing( const prism::hashfs_v2_entry_t *entry, Array<u8> &buffer )
+{
 	const u32 *const plainMetadata = findMetadata( entry, prism::hashfs_v2_meta_t::directory );
 	if( plainMetadata == nullptr )
 	{
-		error_f( "hashfs_v2", m_rootFilename, "Entry metadata is not available!" );
-		return nullptr;
+		return false;
 	}
 
 	prism::fs_meta_plain_t plainMetaValues = { 0 };
 	prism::hashfs_v2_meta_plain_get_value( plainMetadata, plainMetaValues );
 
-	HashFsV2File directoryFile( path, this, entry, plainMetaValues );
+	HashFsV2File directoryFile( "", this, entry, plainMetaValues );
+	buffer.resize( size_t( directoryFile.size() ) );
+	return directoryFile.blockRead( buffer.data(), 0, buffer.size() );
+}
 
-	Array<u8> buffer( size_t( directoryFile.size() ) );
-	if( !directoryFile.blockRead( buffer.data(), 0, buffer.size() ) )
+u32 HashFsV2::buildTree( const String &dirpath )
+{
+	Array<TreeNode> &nodes = m_treeNodes.storage();
+	Array<char> &names = m_treeNames.storage();
+	Array<u32> &directories = m_treeDirectories.storage();
+	if( directories.empty() )
 	{
-		error_f( "hashfs_v2", m_rootFilename, "Entry could not be read!" );
-		return nullptr;
+		directories.assign( m_entryTable.size(), TreeNode::NO_NODE );
 	}
 
-	const uint32_t countOfItems = interpretBufferAt<uint32_t>( buffer, 0 );
-
-	auto result = std::make_unique<List<Entry>>();
+	const u32 root = static_cast<u32>( nodes.size() );
+	nodes.push_back( TreeNode{ 0, 0, 0, 0, true } );
 
-	uint32_t currentLengthOffset = sizeof( uint32_t );
-	uint32_t currentStringOffset = currentLengthOffset + countOfItems * sizeof( uint8_t );
+	// breadth-first, so all children of a directory are appended at once
+	std::deque<Pair<u32, String>> pending;
+	pending.emplace_back( root, dirpath.size() != 1 ? removeSlashAtEnd( dirpath ) : String() );
 
-	for( uint32_t i = 0; i < countOfItems; ++i )
+	Array<u8> buffer;
+	while( !pending.empty() )
 	{
-		const uint8_t pathLength = interpretBufferAt<uint8_t>( buffer, currentLengthOffset );
-		currentLengthOffset += sizeof( uint8_t );
+		const u32 node = pending.front().first;
+		const String path = std::move( pending.front().second );
+		pending.pop_front();
 
-		const String path( &interpretBufferAt<char>( buffer, currentStringOffset, pathLength ), size_t( pathLength ) );
-		currentStringOffset += pathLength;
-
-		if( path[ 0 ] == '/' ) // directory
+		const prism::hashfs_v2_entry_t *const entry = findEntry( path.empty() ? "/" : path );
+		if( !entry || !( entry->m_flags & prism::hashfs_v2_entry_flags_t::directory ) )
 		{
-			String directorypath;
-			if( absolutePaths )
-			{
-				directorypath = removeSlashAtEnd( dirpath ) + "/" + String( path.c_str() + 1 );
-			}
-			else
-			{
-				directorypath = String( path.c_str() + 1 );
-			}
-			result->push_back( Entry( directorypath, true, false, this ) );
+			continue;
+		}
+		directories[ static_cast<size_t>( entry - m_entryTable.data() ) ] = node;
 
-			if( recursive )
-			{
-				auto subdir = readDir( directorypath, absolutePaths, recursive );
-				if( subdir )
-				{
-					result->insert( result->end(), subdir->begin(), subdir->end() );
-				}
-			}
+		if( !readDirectoryListing( entry, buffer ) || buffer.size() < sizeof( u32 ) )
+		{
+			error_f( "hashfs_v2", m_rootFilename, "Unable to read directory listing (%s)!", path.empty() ? "/" : path );
+			continue;
 		}
-		else
+
+		const u32 countOfItems = interpretBufferAt<u32>( buffer, 0 );
+		size_t currentLengthOffset = sizeof( u32 );
+		size_t currentStringOffset = currentLengthOffset + countOfItems * sizeof( u8 );
+
+		nodes[ node ].m_firstChild = static_cast<u32>( nodes.size() );
+		for( u32 i = 0; i < countOfItems && currentStringOffset <= buffer.size(); ++i )
 		{
-			String filepath;
-			if( absolutePaths )
-			{
-				filepath = removeSlashAtEnd( dirpath ) + "/" + path.c_str();
-			}
-			else
+			const u8 nameLength = buffer[ currentLengthOffset++ ];
+			if( nameLength == 0 || currentStringOffset + nameLength > buffer.size() )
 			{
-				filepath = path;
+				break;
 			}
 
-			bool encrypted = false;
-			prism::hashfs_v2_entry_t *const entry = findEntry( removeSlashAtEnd( dirpath ) + "/" + path.c_str() );
-			if( entry )
+			const char *name = reinterpret_cast<const char *>( buffer.data() + currentStringOffset );
+			currentStringOffset += nameLength;
+
+			TreeNode child;
+			child.m_directory = name[ 0 ] == '/';
+			child.m_nameOffset = static_cast<u32>( names.size() );
+			child.m_nameLength = child.m_directory ? nameLength - 1u : nameLength;
+			child.m_firstChild = 0;
+			child.m_childCount = 0;
+			names.insert( names.end(), name + ( nameLength - child.m_nameLength ), name + nameLength );
+
+			if( child.m_directory )
 			{
-				//encrypted = !!(entry->m_flags & HASHFS_ENCRYPTED);
+				pending.emplace_back( static_cast<u32>( nodes.size() ), path + "/" + String( name + 1, child.m_nameLength ) );
 			}
-			result->push_back( Entry( filepath, false, encrypted, this ) );
+			nodes.push_back( child );
+			++nodes[ node ].m_childCount;
 		}
 	}
+	return root;
+}
 
-	return result;
+void HashFsV2::listTree( u32 node, String &prefix, bool recursive, List<Entry> &result )
+{
+	const TreeNode &directory = m_treeNodes[ node ];
+	for( u32 i = 0; i < directory.m_childCount; ++i )
+	{
+		const u32 childIndex = directory.m_firstChild + i;
+		const TreeNode &child = m_treeNodes[ childIndex ];
+
+		const size_t prefixLength = prefix.length();
+		prefix.append( m_treeNames.data() + child.m_nameOffset, child.m_nameLength );
+		result.push_back( Entry( prefix, child.m_directory, false, this ) );
+
+		if( recursive && child.m_directory )
+		{
+			prefix += '/';
+			listTree( childIndex, prefix, recursive, result );
+		}
+		prefix.resize( prefixLength );
+	}
 }
 
 bool HashFsV2::mstat( MetaStat *result, const String &path )
 {
-	prism::hashfs_v2_entry_t *const entry = findEntry( path );
+	const prism::hashfs_v2_entry_t *const entry = findEntry( path );
 	if( !entry )
 	{
 		return false;
@@ -263,9 +337,16 @@ bool HashFsV2::mstat( MetaStat *result, const String &path )
 	return true;
 }
 
+bool HashFsV2::mstatIndexed( EntryHandle entry, MetaStat *result, const String &path )
+{
+	result->m_filesystem = this;
+	mstatEntry( result, &m_entryTable[ static_cast< size_t >( entry ) ] );
+	return true;
+}
+
 UniquePtr<File> HashFsV2::openForReadingWithPlainMeta( const String &filename, const prism::fs_meta_plain_t &plainMetaValues, bool *outFileExists )
 {
-	prism::hashfs_v2_entry_t *const entry = findEntry( filename );
+	const prism::hashfs_v2_entry_t *const entry = findEntry( filename );
 	if( entry == nullptr )
 	{
 		if( outFileExists ) *outFileExists = false;
@@ -274,9 +355,97 @@ UniquePtr<File> HashFsV2::openForReadingWithPlainMeta( const String &filename, c
 
 	if( outFileExists ) *outFileExists = true;
 
+	return openEntry( filename, entry, plainMetaValues );
+}
+
+UniquePtr<File> HashFsV2::openEntry( const String &filename, const prism::hashfs_v2_entry_t *entry, const prism::fs_meta_plain_t &plainMetaValues )
+{
+	if( plainMetaValues.get_compression() != prism::fs_compression_t::nocompress )
+	{
+		if( ContentCache::Content content = getContentCache()->find( this, entry->m_hash, plainMetaValues.get_offset() ) )
+		{
+			return std::make_unique<CachedFile>( filename, this, std::move( content ) );
+		}
+	}
+
 	return std::make_unique<HashFsV2File>( filename, this, entry, plainMetaValues );
 }
 
+bool HashFsV2::locate( const String &path, Location *result )
+{
+	const prism::hashfs_v2_entry_t *const entry = findEntry( path );
+	if( entry == nullptr )
+	{
+		return false;
+	}
+	return locateEntry( entry, result );
+}
+
+bool HashFsV2::locateIndexed( EntryHandle entry, const String &path, Location *result )
+{
+	return locateEntry( &m_entryTable[ static_cast< size_t >( entry ) ], result );
+}
+
+bool HashFsV2::locateEntry( const prism::hashfs_v2_entry_t *entry, Location *result )
+{
+	// data of an entry may be split into several plain chunks (e.g. mips of tobj), the first one is taken
+	bool located = false;
+	walkMetadata( entry, [ & ]( prism::hashfs_v2_meta_t meta, const uint32_t *metadata )
+	{
+		if( !!( meta & prism::hashfs_v2_meta_t::plain ) )
+		{
+			prism::fs_meta_plain_t plainMetaValues = { 0 };
+			prism::hashfs_v2_meta_plain_get_value( metadata, plainMetaValues );
+			if( !located || plainMetaValues.get_offset() < result->m_offset )
+			{
+				const prism::fs_compression_t compression = plainMetaValues.get_compression();
+				result->m_offset = plainMetaValues.get_offset();
+				result->m_size = plainMetaValues.get_compressed_size();
+				result->m_stored = compression == prism::fs_compression_t::nocompress;
+
+				// other streams (e.g. gdeflate) are read in parts and never take staged data
+				result->m_staged = result->m_stored
+				 || compression == prism::fs_compression_t::zlib
+				 || compression == prism::fs_compression_t::zlib_headerless;
+			}
+			located = true;
+		}
+	} );
+
+	if( located )
+	{
+		result->m_filesystem = this;
+	}
+	return located;
+}
+
+bool HashFsV2::prefetch( const Location &location, Array<u8> &staging )
+{
+	if( m_mapping.isMapped() )
+	{
+		m_mapping.willNeed( location.m_offset, location.m_size );
+		return true;
+	}
+
+	staging.resize( static_cast<size_t>( location.m_size ) );
+	return ioRead( staging.data(), location.m_size, location.m_offset );
+}
+
+bool HashFsV2::enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f )
+{
+	if( m_header.m_salt != 0 )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < m_entryTable.size(); ++i )
+	{
+		const prism::hashfs_v2_entry_t &entry = m_entryTable[ i ];
+		f( entry.m_hash, !!( entry.m_flags & prism::hashfs_v2_entry_flags_t::directory ), i );
+	}
+	return true;
+}
+
 void HashFsV2::mstatEntry( MetaStat *result, const prism::hashfs_v2_entry_t *entry )
 {
 	walkMetadata( entry, [ result ]( prism::hashfs_v2_meta_t meta, const u32 *metadata )
@@ -315,12 +484,21 @@ void HashFsV2::mstatEntry( MetaStat *result, const prism::hashfs_v2_entry_t *ent
 
 bool HashFsV2::ioRead( void *const buffer, uint64_t bytes, uint64_t offset )
 {
-	return m_root->blockRead( buffer, offset, bytes );
+	if( m_mapping.isMapped() )
+	{
+		return m_mapping.read( buffer, offset, bytes );
+	}
+	return m_root->readAt( buffer, offset, bytes );
+}
+
+const u8 *HashFsV2::ioView( uint64_t bytes, uint64_t offset ) const
+{
+	return m_mapping.at( offset, bytes );
 }
 
 bool HashFsV2::readHashFS()
 {
-	if( !m_root->blockRead( &m_header, 0, sizeof( prism::hashfs_v2_header_t ) ) )
+	if( !ioRead( &m_header, sizeof( prism::hashfs_v2_header_t ), 0 ) )
 	{
 		error( "hashfs_v2", m_rootFilename, "Failed to read header!" );
 		return false;
@@ -338,15 +516,24 @@ bool HashFsV2::readHashFS()
 		return false;
 	}
 
-	m_entryTable.resize( m_header.m_entry_table_count );
+	// the cache stays mapped, tables, index and tree are used in place
+	UniquePtr<IndexCache> cache = std::make_unique<IndexCache>( m_rootFilename, MAKEFOURCC( 'H', 'F', 'S', '2' ) );
+	if( cache->load() && readIndexCache( *cache ) )
+	{
+		m_indexCache = std::move( cache );
+		return true;
+	}
+
+	Array<prism::hashfs_v2_entry_t> &entryTable = m_entryTable.storage();
+	entryTable.resize( m_header.m_entry_table_count );
 
 	const u32 entryTableSize = m_header.m_entry_table_count * sizeof( prism::hashfs_v2_entry_t );
 
-	static_assert( std::is_same_v< decltype( m_entryTable )::value_type, prism::hashfs_v2_entry_t>, "" ); // following code assumes that m_entryTable is simple container for entries
+	static_assert( std::is_same_v< std::decay_t< decltype( entryTable ) >::value_type, prism::hashfs_v2_entry_t>, "" ); // following code assumes that m_entryTable is simple container for entries
 
 	if( entryTableSize == m_header.m_entry_table_compressed_size ) // entry table is not compressed
 	{
-		if( !m_root->blockRead( m_entryTable.data(), m_header.m_entry_table_offset, entryTableSize ) )
+		if( !ioRead( entryTable.data(), entryTableSize, m_header.m_entry_table_offset ) )
 		{
 			error( "hashfs_v2", m_rootFilename, "Failed to read entry table!" );
 			return false;
@@ -354,26 +541,33 @@ bool HashFsV2::readHashFS()
 	}
 	else
 	{
-		Array<u8> compressedEntryTable( size_t( m_header.m_entry_table_compressed_size ) );
-		if( !m_root->blockRead( compressedEntryTable.data(), m_header.m_entry_table_offset, compressedEntryTable.size() ) )
+		Array<u8> compressedEntryTable;
+		const u8 *compressedEntryTableData = ioView( m_header.m_entry_table_compressed_size, m_header.m_entry_table_offset );
+		if( !compressedEntryTableData )
 		{
-			error( "hashfs_v2", m_rootFilename, "Failed to read entry table!" );
-			return false;
+			compressedEntryTable.resize( size_t( m_header.m_entry_table_compressed_size ) );
+			if( !ioRead( compressedEntryTable.data(), compressedEntryTable.size(), m_header.m_entry_table_offset ) )
+			{
+				error( "hashfs_v2", m_rootFilename, "Failed to read entry table!" );
+				return false;
+			}
+			compressedEntryTableData = compressedEntryTable.data();
 		}
-		if( !unCompress_zlib( m_entryTable.data(), m_entryTable.size() * sizeof( prism::hashfs_v2_entry_t ), compressedEntryTable.data(), compressedEntryTable.size() ) )
+		if( !unCompress_zlib( entryTable.data(), entryTable.size() * sizeof( prism::hashfs_v2_entry_t ), compressedEntryTableData, m_header.m_entry_table_compressed_size ) )
 		{
 			error( "hashfs_v2", m_rootFilename, "Failed to uncompress entry table!" );
 			return false;
 		}
 	}
 
-	m_metadataTable.resize( m_header.m_metadata_table_count );
+	Array<u32> &metadataTable = m_metadataTable.storage();
+	metadataTable.resize( m_header.m_metadata_table_count );
 
 	const u32 metadataTableSize = m_header.m_metadata_table_count * sizeof( u32 );
 
 	if( metadataTableSize == m_header.m_metadata_table_compressed_size )
 	{
-		if( !m_root->blockRead( m_metadataTable.data(), m_header.m_metadata_table_offset, m_metadataTable.size() ) )
+		if( !ioRead( metadataTable.data(), metadataTableSize, m_header.m_metadata_table_offset ) )
 		{
 			error( "hashfs_v2", m_rootFilename, "Failed to read metadata table!" );
 			return false;
@@ -381,22 +575,101 @@ bool HashFsV2::readHashFS()
 	}
 	else
 	{
-		Array<u8> compressedMetadataTable( static_cast<size_t>( m_header.m_metadata_table_compressed_size ) );
-		if( !m_root->blockRead( compressedMetadataTable.data(), m_header.m_metadata_table_offset, compressedMetadataTable.size() ) )
+		Array<u8> compressedMetadataTable;
+		const u8 *compressedMetadataTableData = ioView( m_header.m_metadata_table_compressed_size, m_header.m_metadata_table_offset );
+		if( !compressedMetadataTableData )
 		{
-			error( "hashfs_v2", m_rootFilename, "Failed to read metadata table!" );
-			return false;
+			compressedMetadataTable.resize( static_cast<size_t>( m_header.m_metadata_table_compressed_size ) );
+			if( !ioRead( compressedMetadataTable.data(), compressedMetadataTable.size(), m_header.m_metadata_table_offset ) )
+			{
+				error( "hashfs_v2", m_rootFilename, "Failed to read metadata table!" );
+				return false;
+			}
+			compressedMetadataTableData = compressedMetadataTable.data();
 		}
-		if( !unCompress_zlib( m_metadataTable.data(), m_metadataTable.size() * sizeof( u32 ), compressedMetadataTable.data(), compressedMetadataTable.size() ) )
+		if( !unCompress_zlib( metadataTable.data(), metadataTable.size() * sizeof( u32 ), compressedMetadataTableData, m_header.m_metadata_table_compressed_size ) )
 		{
 			error( "hashfs_v2", m_rootFilename, "Failed to uncompress metadata table!" );
 			return false;
 		}
 	}
 
+	m_entryIndex.build( m_entryTable );
+
+	if( IndexCache::enabled() )
+	{
+		writeIndexCache( *cache );
+	}
+
+	return true;
+}
+
+namespace
+{
+	enum : u32
+	{
+		CACHE_SECTION_ENTRY_TABLE = 1,
+		CACHE_SECTION_METADATA_TABLE = 2,
+		CACHE_SECTION_ENTRY_INDEX = 3,
+		CACHE_SECTION_TREE_NODES = 4,
+		CACHE_SECTION_TREE_NAMES = 5,
+		CACHE_SECTION_TREE_DIRECTORIES = 6,
+	};
+} // namespace
+
+bool HashFsV2::readIndexCache( const IndexCache &cache )
+{
+	uint64_t entryTableSize = 0, metadataTableSize = 0, entryIndexSize = 0;
+	const u8 *const entryTable = cache.section( CACHE_SECTION_ENTRY_TABLE, &entryTableSize );
+	const u8 *const metadataTable = cache.section( CACHE_SECTION_METADATA_TABLE, &metadataTableSize );
+	const u8 *const entryIndex = cache.section( CACHE_SECTION_ENTRY_INDEX, &entryIndexSize );
+	if( !entryTable || entryTableSize != uint64_t( m_header.m_entry_table_count ) * sizeof( prism::hashfs_v2_entry_t )
+	 || !metadataTable || metadataTableSize != uint64_t( m_header.m_metadata_table_count ) * sizeof( u32 )
+	 || !m_entryIndex.assign( entryIndex, entryIndexSize ) )
+	{
+		return false;
+	}
+
+	m_entryTable.assign( entryTable, entryTableSize );
+	m_metadataTable.assign( metadataTable, metadataTableSize );
+
+	// archives without root directory have no tree stored, it is built on demand then
+	uint64_t nodesSize = 0, namesSize = 0, directoriesSize = 0;
+	const u8 *const nodes = cache.section( CACHE_SECTION_TREE_NODES, &nodesSize );
+	const u8 *const names = cache.section( CACHE_SECTION_TREE_NAMES, &namesSize );
+	const u8 *const directories = cache.section( CACHE_SECTION_TREE_DIRECTORIES, &directoriesSize );
+	if( directoriesSize == entryTableSize / sizeof( prism::hashfs_v2_entry_t ) * sizeof( u32 )
+	 && m_treeNodes.assign( nodes, nodesSize ) && m_treeNames.assign( names, namesSize ) )
+	{
+		m_treeDirectories.assign( directories, directoriesSize );
+	}
+	else
+	{
+		m_treeNodes = CachedArray<TreeNode>();
+		m_treeNames = CachedArray<char>();
+	}
 	return true;
 }
 
+void HashFsV2::writeIndexCache( IndexCache &cache )
+{
+	if( m_treeNodes.empty() && findEntry( "/" ) )
+	{
+		buildTree( "/" );
+	}
+
+	cache.addSection( CACHE_SECTION_ENTRY_TABLE, m_entryTable.data(), m_entryTable.byteSize() );
+	cache.addSection( CACHE_SECTION_METADATA_TABLE, m_metadataTable.data(), m_metadataTable.byteSize() );
+	cache.addSection( CACHE_SECTION_ENTRY_INDEX, m_entryIndex.data(), m_entryIndex.byteSize() );
+	if( !m_treeNodes.empty() )
+	{
+		cache.addSection( CACHE_SECTION_TREE_NODES, m_treeNodes.data(), m_treeNodes.byteSize() );
+		cache.addSection( CACHE_SECTION_TREE_NAMES, m_treeNames.data(), m_treeNames.byteSize() );
+		cache.addSection( CACHE_SECTION_TREE_DIRECTORIES, m_treeDirectories.data(), m_treeDirectories.byteSize() );
+	}
+	cache.store();
+}
+
 const u32 *HashFsV2::findMetadata( const prism::hashfs_v2_entry_t *entry, prism::hashfs_v2_meta_t meta )
 {
 	const u32 metadataIndex = entry->m_metadata_index;
@@ -422,45 +695,25 @@ void HashFsV2::walkMetadata( const prism::hashfs_v2_entry_t *entry, std::functio
 	}
 }
 
-prism::hashfs_v2_entry_t *HashFsV2::findEntry( const String &path )
+u64 HashFsV2::hashPath( const String &path ) const
 {
-	if( m_entryTable.empty() )
-	{
-		return nullptr;
-	}
-
-	String pathToFind;
 	if( m_header.m_salt != 0 )
 	{
-		pathToFind = fmt::sprintf( "%u%s", m_header.m_salt, ( path.c_str() + 1 ) );
+		const String pathToFind = fmt::sprintf( "%u%s", m_header.m_salt, ( path.c_str() + 1 ) );
+		return prism::city_hash_64( pathToFind.c_str(), pathToFind.length() );
 	}
-	else
-	{
-		pathToFind = path.c_str() + 1;
-	}
-
-	const u64 hash = prism::city_hash_64( pathToFind.c_str(), pathToFind.length() );
+	return path.empty() ? prism::city_hash_64( "", 0 ) : prism::city_hash_64( path.c_str() + 1, path.length() - 1 );
+}
 
-	for( s64 index, l = 0, r = m_entryTable.size() - 1; l <= r;) // binary search
+const prism::hashfs_v2_entry_t *HashFsV2::findEntry( const String &path )
+{
+	if( m_entryTable.empty() )
 	{
-		index = l + ( r - l ) / 2;
-
-		if( m_entryTable[ static_cast< size_t >( index ) ].m_hash == hash )
-		{
-			return &m_entryTable[ static_cast< size_t >( index ) ];
-		}
-
-		if( m_entryTable[ static_cast< size_t >( index ) ].m_hash < hash )
-		{
-			l = index + 1;
-		}
-		else
-		{
-			r = index - 1;
-		}
+		return nullptr;
 	}
 
-	return nullptr;
+	const u32 index = m_entryIndex.find( hashPath( path ) );
+	return index != HashIndex::NOT_FOUND ? &m_entryTable[ index ] : nullptr;
 }
 
 prism::token_t HashFsV2::getMetaTokenName( prism::hashfs_v2_meta_t meta )
@@ -23,8 +23,15 @@
 #pragma once
 
 #include "filesystem.h"
+#include "file_mapping.h"
 
 #include "structs/hashfs_0x02.h"
+#include "hash_index.h"
+#include "cached_array.h"
+
+#include <mutex>
+
+class IndexCache;
 
 class HashFsV2 final : public FileSystem
 {
@@ -49,9 +56,25 @@ public:
 	virtual bool mstat( MetaStat *result, const String &path ) override;
 
 	virtual UniquePtr<File> openForReadingWithPlainMeta( const String &filename, const prism::fs_meta_plain_t &plainMetaValues, bool *outFileExists = nullptr ) override;
+	virtual bool enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f ) override;
+	virtual UniquePtr<File> openIndexed( EntryHandle entry, const String &filePath, FsOpenMode mode ) override;
+	virtual bool mstatIndexed( EntryHandle entry, MetaStat *result, const String &path ) override;
+	virtual bool locateIndexed( EntryHandle entry, const String &path, Location *result ) override;
+	virtual bool locate( const String &path, Location *result ) override;
+	virtual bool prefetch( const Location &location, Array<u8> &staging ) override;
 
 	bool ioRead( void *const buffer, uint64_t bytes, uint64_t offset );
 
+	/**
+	 * Returns pointer into the mapped archive, or nullptr when the archive is not mapped.
+	 */
+	const u8 *ioView( uint64_t bytes, uint64_t offset ) const;
+
+	/**
+	 * Returns the archive file, it is open even when the archive is mapped.
+	 */
+	inline File *device() const { return m_root.get(); }
+
 	const u32 *findMetadata( const prism::hashfs_v2_entry_t *entry, prism::hashfs_v2_meta_t meta );
 	void walkMetadata( const prism::hashfs_v2_entry_t *entry, std::function< void( prism::hashfs_v2_meta_t meta, const uint32_t *metadata ) > f );
 
@@ -59,17 +82,63 @@ public:
 
 	static prism::token_t getMetaTokenName( prism::hashfs_v2_meta_t meta );
 
+public:
+	/**
+	 * Archives are memory mapped unless disabled (-noMmap), then they are read through their file.
+	 */
+	static inline void setMemoryMapping( bool enabled ) { s_memoryMappingEnabled = enabled; }
+	static inline bool memoryMappingEnabled() { return s_memoryMappingEnabled; }
+
 private:
 	bool readHashFS();
-	prism::hashfs_v2_entry_t *findEntry( const String &path );
+	UniquePtr<File> openEntry( const String &filename, const prism::hashfs_v2_entry_t *entry );
+	UniquePtr<File> openEntry( const String &filename, const prism::hashfs_v2_entry_t *entry, const prism::fs_meta_plain_t &plainMetaValues );
+	bool locateEntry( const prism::hashfs_v2_entry_t *entry, Location *result );
+
+	bool readDirectoryListing( const prism::hashfs_v2_entry_t *entry, Array<u8> &buffer );
+	u32 buildTree( const String &dirpath );
+	void listTree( u32 node, String &prefix, bool recursive, List<Entry> &result );
+	bool readIndexCache( const IndexCache &cache );
+	void writeIndexCache( IndexCache &cache );
+	u64 hashPath( const String &path ) const;
+	const prism::hashfs_v2_entry_t *findEntry( const String &path );
 
 private:
 	String m_rootFilename;
 	UniquePtr<File> m_root;
+	FileMapping m_mapping;
 
 	prism::hashfs_v2_header_t m_header;
-	Array<prism::hashfs_v2_entry_t> m_entryTable;
-	Array<u32> m_metadataTable;
+	CachedArray<prism::hashfs_v2_entry_t> m_entryTable;
+	CachedArray<u32> m_metadataTable;
+	HashIndex m_entryIndex;
+
+	/**
+	 * Index cache the tables, the index and the tree refer to, when the archive was mounted from it.
+	 */
+	UniquePtr<IndexCache> m_indexCache;
+
+	/**
+	 * Directory tree built from the directory listings on the first readDir, or stored in the index cache.
+	 * Children of every directory occupy a continuous range of nodes, names are stored in one arena.
+	 */
+	struct TreeNode
+	{
+		static constexpr u32 NO_NODE = 0xFFFFFFFF;
+
+		u32 m_nameOffset;
+		u32 m_nameLength;
+		u32 m_firstChild;
+		u32 m_childCount;
+		bool m_directory;
+	};
+
+	std::mutex m_treeMutex;
+	CachedArray<TreeNode> m_treeNodes;
+	CachedArray<char> m_treeNames;
+	CachedArray<u32> m_treeDirectories; // index of entry -> node of the directory, NO_NODE if not in the tree
+
+	static bool s_memoryMappingEnabled;
 };
 
 /* eof */
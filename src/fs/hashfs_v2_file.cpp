@@ -26,6 +26,11 @@
 
 #include "hashfs_v2.h"
 
+#include "content_cache.h"
+#include "prefetcher.h"
+
+#include <config.h>
+
 HashFsV2File::HashFsV2File( const String &filepath, HashFsV2 *filesystem, const prism::hashfs_v2_entry_t *entry, const prism::fs_meta_plain_t &plainMetaValues )
 	: m_filepath( filepath )
 	, m_filesystem( filesystem )
@@ -91,14 +96,19 @@ uint64_t HashFsV2File::read( void *buffer, uint64_t elementSize, uint64_t elemen
 			return 0;
 		}
 
-		if( m_filesystem->ioRead( buffer, bytesCount, m_deviceOffset + m_position ) )
+		const uint64_t result = std::min( bytesCount, m_size - m_position );
+
+		Array<u8> staged;
+		if( m_position == 0 && result == m_size && getPrefetcher()->take( m_filesystem, m_deviceOffset, staged ) && staged.size() == m_size )
 		{
-			uint64_t result = std::min( bytesCount, m_size - m_position );
-			m_position += bytesCount;
-			if( m_position > m_size )
-			{
-				m_position = m_size;
-			}
+			memcpy( buffer, staged.data(), static_cast<size_t>( result ) );
+			m_position += result;
+			return result;
+		}
+
+		if( m_filesystem->ioRead( buffer, result, m_deviceOffset + m_position ) )
+		{
+			m_position += result;
 			return result;
 		}
 		else
@@ -108,6 +118,11 @@ uint64_t HashFsV2File::read( void *buffer, uint64_t elementSize, uint64_t elemen
 	}
 	else if( m_compression == prism::fs_compression_t::zlib )
 	{
+		if( m_position == 0 && bytesCount >= m_size && m_size != 0 )
+		{
+			return zlibReadWhole( buffer );
+		}
+
 		const uint64_t chunk = 1024 * 4;
 		uint8_t inbuffer[ chunk ];
 		uint64_t bufferOffset = 0;
@@ -115,20 +130,27 @@ uint64_t HashFsV2File::read( void *buffer, uint64_t elementSize, uint64_t elemen
 		while( m_position < m_compressedSize && bufferOffset < bytesCount )
 		{
 			uint64_t left = m_compressedSize - m_position;
-			uint64_t bytes = std::min( chunk, left );
+
+			// when the archive is mapped, inflate straight from the view instead of copying through inbuffer
+			const u8 *input = m_filesystem->ioView( left, m_deviceOffset + m_position );
+			uint64_t bytes = input ? std::min<uint64_t>( left, UINT32_MAX ) : std::min( chunk, left );
 			if( bytes == 0 )
 			{
 				break;
 			}
 
-			if( !m_filesystem->ioRead( inbuffer, bytes, m_deviceOffset + m_position ) )
+			if( !input )
 			{
-				error( "hashfs_v2", m_filepath, "Unable to read from filesystem file" );
-				return 0;
+				if( !m_filesystem->ioRead( inbuffer, bytes, m_deviceOffset + m_position ) )
+				{
+					error( "hashfs_v2", m_filepath, "Unable to read from filesystem file" );
+					return 0;
+				}
+				input = inbuffer;
 			}
 
 			m_zlibStream->avail_in = static_cast< unsigned int >( bytes );
-			m_zlibStream->next_in = inbuffer;
+			m_zlibStream->next_in = const_cast< uint8_t * >( input );
 
 			m_zlibStream->avail_out = static_cast< unsigned int >( bytesCount - bufferOffset );
 			m_zlibStream->next_out = reinterpret_cast<uint8_t *>( buffer ) + bufferOffset;
@@ -147,27 +169,12 @@ uint64_t HashFsV2File::read( void *buffer, uint64_t elementSize, uint64_t elemen
 			assert( bufferOffset <= bytesCount );
 			m_position += ( bytes - m_zlibStream->avail_in );
 		}
+		m_inflated += bufferOffset;
 		return bufferOffset;
 	}
 	else if( m_compression == prism::fs_compression_t::gdeflate )
 	{
-		assert( m_position == 0 );
-		assert( bytesCount == m_size );
-
-		Array< uint8_t > compressedBuffer( static_cast< size_t >( m_compressedSize ) );
-		if( !m_filesystem->ioRead( compressedBuffer.data(), m_compressedSize, m_deviceOffset ) )
-		{
-			error( "hashfs_v2", m_filepath, "Unable to read from filesystem file" );
-			return 0;
-		}
-
-		if( !GDeflate::Decompress( reinterpret_cast< uint8_t * >( buffer ), size_t( bytesCount ), compressedBuffer.data(), compressedBuffer.size(), 1 ) )
-		{
-			error( "hashfs_v2", m_filepath, "GDeflate returned error!" );
-			return 0;
-		}
-
-		return bytesCount;
+		return gdeflateRead( reinterpret_cast< u8 * >( buffer ), bytesCount );
 	}
 	else
 	{
@@ -183,7 +190,7 @@ uint64_t HashFsV2File::size()
 
 bool HashFsV2File::seek( uint64_t offset, Attrib attr )
 {
-	if( m_compression == prism::fs_compression_t::nocompress )
+	if( m_compression == prism::fs_compression_t::nocompress || m_compression == prism::fs_compression_t::gdeflate ) // gdeflate tiles are decoded independently
 	{
 		if( attr == SeekSet )
 		{
@@ -201,29 +208,15 @@ bool HashFsV2File::seek( uint64_t offset, Attrib attr )
 	}
 	else if( m_compression == prism::fs_compression_t::zlib )
 	{
-		if( offset == 0 && attr == SeekSet )
+		const uint64_t target = attr == SeekSet ? offset : attr == SeekCur ? m_inflated + offset : size() - offset;
+		if( target < m_inflated || ( target == 0 && m_position != 0 ) )
 		{
-			if( m_position != 0 )
-			{
-				zlibInflateDestroy();
-				zlibInflateInitialize();
-			}
-			return true;
+			zlibInflateDestroy();
+			zlibInflateInitialize();
+			m_position = 0;
+			m_inflated = 0;
 		}
-		return false; // random access is not allowed
-	}
-	else if( m_compression == prism::fs_compression_t::gdeflate )
-	{
-		if( offset == 0 && attr == SeekSet )
-		{
-			if( m_position != 0 )
-			{
-				gdeflateDecompressorDestroy();
-				gdeflateDecompressorInitialize();
-			}
-			return true;
-		}
-		return false; // random access is not allowed
+		return discard( target - m_inflated ); // zlib stream can only be decoded forward
 	}
 	else
 	{
@@ -239,7 +232,7 @@ void HashFsV2File::rewind()
 
 uint64_t HashFsV2File::tell() const
 {
-	return m_position;
+	return m_compression == prism::fs_compression_t::zlib ? m_inflated : m_position;
 }
 
 void HashFsV2File::flush()
@@ -251,6 +244,29 @@ void HashFsV2File::mstat( MetaStat *result )
 	m_filesystem->mstatEntry( result, m_entry );
 }
 
+FileView HashFsV2File::view()
+{
+	// stored entries are viewed straight in the mapped archive
+	if( m_compression == prism::fs_compression_t::nocompress )
+	{
+		if( const u8 *const data = m_filesystem->ioView( m_size, m_deviceOffset ) )
+		{
+			return FileView( data, static_cast<size_t>( m_size ) );
+		}
+	}
+	return File::view();
+}
+
+File *HashFsV2File::storage( uint64_t *offset )
+{
+	if( m_compression != prism::fs_compression_t::nocompress )
+	{
+		return nullptr;
+	}
+	*offset = m_deviceOffset;
+	return m_filesystem->device();
+}
+
 void HashFsV2File::zlibInflateInitialize()
 {
 	assert( m_zlibStream == nullptr );
@@ -277,4 +293,155 @@ void HashFsV2File::zlibInflateDestroy()
 	}
 }
 
+uint64_t HashFsV2File::zlibReadWhole( void *buffer )
+{
+	Array< u8 > compressedBuffer;
+	const u8 *compressedData = nullptr;
+	if( getPrefetcher()->take( m_filesystem, m_deviceOffset, compressedBuffer ) && compressedBuffer.size() == m_compressedSize )
+	{
+		compressedData = compressedBuffer.data();
+	}
+	else
+	{
+		compressedData = m_filesystem->ioView( m_compressedSize, m_deviceOffset );
+	}
+	if( !compressedData )
+	{
+		compressedBuffer.resize( static_cast< size_t >( m_compressedSize ) );
+		if( !m_filesystem->ioRead( compressedBuffer.data(), m_compressedSize, m_deviceOffset ) )
+		{
+			error( "hashfs_v2", m_filepath, "Unable to read from filesystem file" );
+			return 0;
+		}
+		compressedData = compressedBuffer.data();
+	}
+
+	if( !unCompressWhole_zlib( buffer, m_size, compressedData, m_compressedSize ) )
+	{
+		error( "hashfs_v2", m_filepath, "Unable to decompress file" );
+		return 0;
+	}
+
+	getContentCache()->insert( m_filesystem, m_entry->m_hash, m_deviceOffset, buffer, m_size );
+
+	m_position = m_compressedSize;
+	m_inflated = m_size;
+	return m_size;
+}
+
+bool HashFsV2File::gdeflateReadStream()
+{
+	u8 header[ GDeflateStream::HEADER_SIZE ];
+	if( m_compressedSize < sizeof( header ) || !m_filesystem->ioRead( header, sizeof( header ), m_deviceOffset ) )
+	{
+		error( "hashfs_v2", m_filepath, "Unable to read GDeflate stream header" );
+		return false;
+	}
+
+	const uint64_t headerSize = m_gdeflateStream.readHeader( header, m_size );
+	if( headerSize == 0 || headerSize > m_compressedSize )
+	{
+		error( "hashfs_v2", m_filepath, "Invalid GDeflate stream header" );
+		return false;
+	}
+
+	Array< u8 > tileOffsets( static_cast< size_t >( headerSize - sizeof( header ) ) );
+	if( !m_filesystem->ioRead( tileOffsets.data(), tileOffsets.size(), m_deviceOffset + sizeof( header ) ) )
+	{
+		error( "hashfs_v2", m_filepath, "Unable to read GDeflate tile offsets" );
+		return false;
+	}
+
+	if( !m_gdeflateStream.readTileOffsets( tileOffsets.data(), m_compressedSize ) )
+	{
+		error( "hashfs_v2", m_filepath, "Invalid GDeflate tile offsets" );
+		return false;
+	}
+
+	m_gdeflateStreamRead = true;
+	return true;
+}
+
+bool HashFsV2File::gdeflateDecompress( u8 *output, u32 first, u32 count )
+{
+	const uint64_t begin = m_gdeflateStream.tileOffset( first );
+	const uint64_t end = m_gdeflateStream.tileOffset( first + count - 1 ) + m_gdeflateStream.tileCompressedSize( first + count - 1 );
+
+	Array< u8 > compressedBuffer;
+	const u8 *compressedData = m_filesystem->ioView( end - begin, m_deviceOffset + begin );
+	if( !compressedData )
+	{
+		compressedBuffer.resize( static_cast< size_t >( end - begin ) );
+		if( !m_filesystem->ioRead( compressedBuffer.data(), compressedBuffer.size(), m_deviceOffset + begin ) )
+		{
+			error( "hashfs_v2", m_filepath, "Unable to read from filesystem file" );
+			return false;
+		}
+		compressedData = compressedBuffer.data();
+	}
+
+	if( !m_gdeflateStream.decompress( output, compressedData, first, count, std::max( 1u, Config::s_gdeflateWorkers ) ) )
+	{
+		error( "hashfs_v2", m_filepath, "GDeflate returned error!" );
+		return false;
+	}
+	return true;
+}
+
+uint64_t HashFsV2File::gdeflateRead( u8 *buffer, uint64_t bytes )
+{
+	if( m_position >= m_size )
+	{
+		return 0;
+	}
+
+	if( !m_gdeflateStreamRead && !gdeflateReadStream() )
+	{
+		return 0;
+	}
+
+	const uint64_t begin = m_position;
+	const uint64_t end = std::min( m_size, m_position + bytes );
+	while( m_position < end )
+	{
+		const u32 tile = m_gdeflateStream.tileAt( m_position );
+		const uint64_t tileBegin = uint64_t( tile ) * GDeflateStream::TILE_SIZE;
+		const uint64_t tileEnd = tileBegin + m_gdeflateStream.tileSize( tile );
+
+		if( m_position == tileBegin && tileEnd <= end )
+		{
+			// whole tiles go straight to the caller's buffer
+			const u32 lastTile = end == m_size ? m_gdeflateStream.tileCount() : m_gdeflateStream.tileAt( end );
+			if( !gdeflateDecompress( buffer + ( m_position - begin ), tile, lastTile - tile ) )
+			{
+				break;
+			}
+			m_position = std::min( end, uint64_t( lastTile ) * GDeflateStream::TILE_SIZE );
+		}
+		else
+		{
+			if( m_gdeflateCachedTile != tile )
+			{
+				m_gdeflateTile.resize( GDeflateStream::TILE_SIZE );
+				if( !gdeflateDecompress( m_gdeflateTile.data(), tile, 1 ) )
+				{
+					m_gdeflateCachedTile = UINT32_MAX;
+					break;
+				}
+				m_gdeflateCachedTile = tile;
+			}
+
+			const uint64_t bytesFromTile = std::min( end, tileEnd ) - m_position;
+			memcpy( buffer + ( m_position - begin ), m_gdeflateTile.data() + ( m_position - tileBegin ), static_cast< size_t >( bytesFromTile ) );
+			m_position += bytesFromTile;
+		}
+	}
+
+	if( begin == 0 && m_position == m_size )
+	{
+		getContentCache()->insert( m_filesystem, m_entry->m_hash, m_deviceOffset, buffer, m_size );
+	}
+	return m_position - begin;
+}
+
 /* eof */
@@ -28,6 +28,8 @@
 
 #include "GDeflate.h"
 
+#include <utils/compression.h>
+
 class HashFsV2;
 
 class HashFsV2File : public File
@@ -49,6 +51,8 @@ public:
 	virtual uint64_t tell() const override;
 	virtual void flush() override;
 	virtual void mstat( MetaStat *result ) override;
+	virtual FileView view() override;
+	virtual File *storage( uint64_t *offset ) override;
 
 private:
 	String			m_filepath;
@@ -58,6 +62,7 @@ private:
 	prism::fs_compression_t m_compression = prism::fs_compression_t::nocompress;
 
 	uint64_t		m_position = 0;
+	uint64_t		m_inflated = 0; // position in decompressed data of zlib entries
 
 	uint64_t m_compressedSize = 0;
 	uint64_t m_size = 0;
@@ -65,13 +70,23 @@ private:
 
 	z_stream *m_zlibStream = nullptr;
 
+	GDeflateStream m_gdeflateStream;
+	bool m_gdeflateStreamRead = false;
+	u32 m_gdeflateCachedTile = UINT32_MAX;
+	Array<u8> m_gdeflateTile; // last decompressed tile, serves reads which are not aligned to tiles
+
 private:
 	void zlibInflateInitialize();
 	void zlibInflateDestroy();
+	uint64_t zlibReadWhole( void *buffer );
 
 	inline void gdeflateDecompressorInitialize() {}
 	inline void gdeflateDecompressorDestroy() {}
 
+	bool gdeflateReadStream();
+	bool gdeflateDecompress( u8 *output, u32 first, u32 count );
+	uint64_t gdeflateRead( u8 *buffer, uint64_t bytes );
+
 	//friend class HashFsV2;
 };
 
@@ -0,0 +1,244 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/index_cache.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "index_cache.h"
+
+#include "sysfilesystem.h"
+#include "file.h"
+
+String IndexCache::s_directory;
+
+namespace
+{
+	constexpr u32 CACHE_MAGIC = MAKEFOURCC( 'P', 'I', 'X', 'I' );
+	constexpr u32 CACHE_VERSION = 1;
+	constexpr u32 SECTION_ARCHIVE_PATH = 0xFFFFFFFF;
+	constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+	struct CacheHeader
+	{
+		u32 m_magic;
+		u32 m_version;
+		u32 m_kind;
+		u32 m_sectionCount;
+		uint64_t m_archiveSize;
+		int64_t m_archiveModificationTime;
+	};
+
+	struct CacheSection
+	{
+		u32 m_id;
+		u32 m_reserved;
+		uint64_t m_offset;
+		uint64_t m_size;
+	};
+
+	inline uint64_t alignSection( uint64_t offset )
+	{
+		return ( offset + SECTION_ALIGNMENT - 1 ) & ~( SECTION_ALIGNMENT - 1 );
+	}
+
+	String absolutePath( const String &path )
+	{
+	#ifdef _WIN32
+		char buffer[ _MAX_PATH ];
+		return _fullpath( buffer, path.c_str(), _MAX_PATH ) ? String( buffer ) : path;
+	#else
+		char *const resolved = realpath( path.c_str(), nullptr );
+		if( !resolved )
+		{
+			return path;
+		}
+		const String result = resolved;
+		free( resolved );
+		return result;
+	#endif
+	}
+} // namespace
+
+IndexCache::IndexCache( const String &archivePath, u32 kind )
+	: m_archivePath( absolutePath( archivePath ) )
+	, m_kind( kind )
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	m_archiveStat = _stat64( m_archivePath.c_str(), &st ) == 0;
+#else
+	struct stat st;
+	m_archiveStat = ::stat( m_archivePath.c_str(), &st ) == 0;
+#endif
+	if( m_archiveStat )
+	{
+		m_archiveSize = static_cast<uint64_t>( st.st_size );
+		m_archiveModificationTime = static_cast<int64_t>( st.st_mtime );
+	}
+}
+
+IndexCache::~IndexCache() = default;
+
+bool IndexCache::load()
+{
+	if( !enabled() || !m_archiveStat || !m_mapping.map( cacheFilePath() ) )
+	{
+		return false;
+	}
+
+	const CacheHeader *const header = reinterpret_cast<const CacheHeader *>( m_mapping.at( 0, sizeof( CacheHeader ) ) );
+	if( !header
+	 || header->m_magic != CACHE_MAGIC
+	 || header->m_version != CACHE_VERSION
+	 || header->m_kind != m_kind
+	 || header->m_archiveSize != m_archiveSize
+	 || header->m_archiveModificationTime != m_archiveModificationTime
+	 || !m_mapping.at( sizeof( CacheHeader ), uint64_t( header->m_sectionCount ) * sizeof( CacheSection ) ) )
+	{
+		m_mapping.unmap();
+		return false;
+	}
+
+	// different archive with the same path hash
+	uint64_t pathSize = 0;
+	const u8 *const path = section( SECTION_ARCHIVE_PATH, &pathSize );
+	if( !path || pathSize != m_archivePath.length() || memcmp( path, m_archivePath.c_str(), m_archivePath.length() ) != 0 )
+	{
+		m_mapping.unmap();
+		return false;
+	}
+
+	return true;
+}
+
+const u8 *IndexCache::section( u32 id, uint64_t *outSize ) const
+{
+	if( !m_mapping.isMapped() )
+	{
+		return nullptr;
+	}
+
+	const CacheHeader *const header = reinterpret_cast<const CacheHeader *>( m_mapping.data() );
+	const CacheSection *const sections = reinterpret_cast<const CacheSection *>( m_mapping.data() + sizeof( CacheHeader ) );
+	for( u32 i = 0; i < header->m_sectionCount; ++i )
+	{
+		if( sections[ i ].m_id == id )
+		{
+			const u8 *const data = m_mapping.at( sections[ i ].m_offset, sections[ i ].m_size );
+			if( data && outSize ) *outSize = sections[ i ].m_size;
+			return data;
+		}
+	}
+	return nullptr;
+}
+
+void IndexCache::addSection( u32 id, Array<u8> &&data )
+{
+	m_sections.emplace_back( id, std::move( data ) );
+}
+
+void IndexCache::addSection( u32 id, const void *data, uint64_t size )
+{
+	const u8 *const bytes = static_cast<const u8 *>( data );
+	addSection( id, Array<u8>( bytes, bytes + size ) );
+}
+
+bool IndexCache::store()
+{
+	if( !enabled() || !m_archiveStat )
+	{
+		return false;
+	}
+
+	if( !getSFS()->mkdir( s_directory ) )
+	{
+		warning( "index_cache", s_directory, "Unable to create cache directory!" );
+		return false;
+	}
+
+	addSection( SECTION_ARCHIVE_PATH, m_archivePath.c_str(), m_archivePath.length() );
+
+	CacheHeader header;
+	header.m_magic = CACHE_MAGIC;
+	header.m_version = CACHE_VERSION;
+	header.m_kind = m_kind;
+	header.m_sectionCount = static_cast<u32>( m_sections.size() );
+	header.m_archiveSize = m_archiveSize;
+	header.m_archiveModificationTime = m_archiveModificationTime;
+
+	Array<CacheSection> sections( m_sections.size() );
+	uint64_t offset = alignSection( sizeof( CacheHeader ) + sections.size() * sizeof( CacheSection ) );
+	for( size_t i = 0; i < m_sections.size(); ++i )
+	{
+		sections[ i ].m_id = m_sections[ i ].first;
+		sections[ i ].m_reserved = 0;
+		sections[ i ].m_offset = offset;
+		sections[ i ].m_size = m_sections[ i ].second.size();
+		offset = alignSection( offset + sections[ i ].m_size );
+	}
+
+	Array<u8> content( static_cast<size_t>( offset ), 0 );
+	memcpy( content.data(), &header, sizeof( CacheHeader ) );
+	memcpy( content.data() + sizeof( CacheHeader ), sections.data(), sections.size() * sizeof( CacheSection ) );
+	for( size_t i = 0; i < m_sections.size(); ++i )
+	{
+		std::copy( m_sections[ i ].second.begin(), m_sections[ i ].second.end(), content.begin() + static_cast<ptrdiff_t>( sections[ i ].m_offset ) );
+	}
+	m_sections.clear();
+
+	// write under temporary name so concurrent runs never map half-written file
+	const String cacheFile = cacheFilePath();
+#ifdef _WIN32
+	const String temporaryFile = fmt::sprintf( "%s.%u.tmp", cacheFile.c_str(), static_cast<u32>( GetCurrentProcessId() ) );
+#else
+	const String temporaryFile = fmt::sprintf( "%s.%u.tmp", cacheFile.c_str(), static_cast<u32>( getpid() ) );
+#endif
+	{
+		auto file = getSFS()->open( temporaryFile, FileSystem::write | FileSystem::binary );
+		if( !file || file->write( content.data(), 1, content.size() ) != content.size() )
+		{
+			warning( "index_cache", temporaryFile, "Unable to write cache file!" );
+			file.reset();
+			std::remove( temporaryFile.c_str() );
+			return false;
+		}
+	}
+
+#ifdef _WIN32
+	const bool renamed = !!MoveFileExA( temporaryFile.c_str(), cacheFile.c_str(), MOVEFILE_REPLACE_EXISTING );
+#else
+	const bool renamed = ::rename( temporaryFile.c_str(), cacheFile.c_str() ) == 0;
+#endif
+	if( !renamed )
+	{
+		std::remove( temporaryFile.c_str() );
+		return false;
+	}
+	return true;
+}
+
+String IndexCache::cacheFilePath() const
+{
+	const u64 hash = prism::city_hash_64( m_archivePath.c_str(), m_archivePath.length() );
+	return fmt::sprintf( "%s%016llx_%08x.idx", makeSlashAtEnd( s_directory ).c_str(), static_cast<unsigned long long>( hash ), m_kind );
+}
+
+/* eof */
@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/index_cache.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include "file_mapping.h"
+
+/**
+ * On-disk cache of decoded archive indexes (entry tables, directory listings...).
+ *
+ * Every archive gets one file in the cache directory named after hash of its path.
+ * The file is valid as long as size and modification time of the archive match
+ * and consists of header, section table and 16-byte aligned sections, so it can be
+ * used directly from the mapped view.
+ */
+class IndexCache
+{
+public:
+	IndexCache( const String &archivePath, u32 kind );
+	IndexCache( const IndexCache & ) = delete;
+	IndexCache( IndexCache && ) = delete;
+	~IndexCache();
+
+	IndexCache &operator=( const IndexCache & ) = delete;
+	IndexCache &operator=( IndexCache && ) = delete;
+
+	/**
+	 * Maps the cache file of the archive, returns false when it does not exist or is stale.
+	 */
+	bool load();
+
+	/**
+	 * Returns pointer to the section in the mapped cache file or nullptr if there is no such section.
+	 */
+	const u8 *section( u32 id, uint64_t *outSize ) const;
+
+	void addSection( u32 id, Array<u8> &&data );
+	void addSection( u32 id, const void *data, uint64_t size );
+
+	/**
+	 * Writes added sections to the cache directory.
+	 */
+	bool store();
+
+	static inline bool enabled() { return !s_directory.empty(); }
+
+public:
+	static String s_directory;
+
+private:
+	String cacheFilePath() const;
+
+private:
+	String m_archivePath;
+	u32 m_kind;
+	bool m_archiveStat = false;
+	uint64_t m_archiveSize = 0;
+	int64_t m_archiveModificationTime = 0;
+
+	FileMapping m_mapping;
+	Array<Pair<u32, Array<u8>>> m_sections;
+};
+
+/* eof */
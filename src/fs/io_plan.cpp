@@ -0,0 +1,75 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/io_plan.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "io_plan.h"
+
+void sortByLocation( FileSystem &filesystem, Array<String> &paths )
+{
+	struct Item
+	{
+		size_t m_device; // order of the first appearance of the filesystem
+		FileSystem::Location m_location;
+		String m_path;
+	};
+
+	Array<Item> items;
+	items.reserve( paths.size() );
+
+	Array<FileSystem *> devices;
+	for( String &path : paths )
+	{
+		Item item;
+		if( filesystem.locate( path, &item.m_location ) )
+		{
+			const auto it = std::find( devices.begin(), devices.end(), item.m_location.m_filesystem );
+			item.m_device = static_cast<size_t>( it - devices.begin() ) + 1;
+			if( it == devices.end() )
+			{
+				devices.push_back( item.m_location.m_filesystem );
+			}
+		}
+		else
+		{
+			item.m_device = 0;
+		}
+		item.m_path = std::move( path );
+		items.push_back( std::move( item ) );
+	}
+
+	std::stable_sort( items.begin(), items.end(), []( const Item &a, const Item &b )
+	{
+		if( a.m_device != b.m_device )
+		{
+			return a.m_device < b.m_device;
+		}
+		return a.m_device != 0 && a.m_location.m_offset < b.m_location.m_offset;
+	} );
+
+	for( size_t i = 0; i < items.size(); ++i )
+	{
+		paths[ i ] = std::move( items[ i ].m_path );
+	}
+}
+
+/* eof */
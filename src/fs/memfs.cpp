@@ -103,7 +103,23 @@ bool MemFileSystem::dirExists( const String &dirpath )
 
 auto MemFileSystem::readDir( const String &path, bool absolutePaths, bool recursive ) -> UniquePtr<List<Entry>>
 {
-    return nullptr; // not supported
+    const String prefix = makeSlashAtEnd( path );
+    UniquePtr<List<Entry>> result = std::make_unique<List<Entry>>();
+    for( const UniquePtr<StoredEntry> &entry : m_storedEntries )
+    {
+        if( entry->m_path.length() <= prefix.length() || entry->m_path.compare( 0, prefix.length(), prefix ) != 0 )
+        {
+            continue;
+        }
+
+        const String relativePath = entry->m_path.substr( prefix.length() );
+        if( !recursive && relativePath.find( '/' ) != String::npos )
+        {
+            continue;
+        }
+        result->push_back( Entry( absolutePaths ? entry->m_path : relativePath, entry->m_isDirectory, false, this ) );
+    }
+    return result;
 }
 
 bool MemFileSystem::mstat( MetaStat *result, const String &path )
@@ -118,14 +134,8 @@ bool MemFileSystem::mstat( MetaStat *result, const String &path )
 
 auto MemFileSystem::findEntry( const String &path ) const -> StoredEntry *
 {
-    for( const UniquePtr<StoredEntry> &entry : m_storedEntries )
-    {
-        if( entry->m_path == path )
-        {
-            return entry.get();
-        }
-    }
-    return nullptr;
+    const auto it = m_entriesByPath.find( path );
+    return it != m_entriesByPath.end() ? it->second : nullptr;
 }
 
 auto MemFileSystem::findOrCreateEntry( const String &path, bool *outOptCreated ) -> StoredEntry *
@@ -135,10 +145,11 @@ auto MemFileSystem::findOrCreateEntry( const String &path, bool *outOptCreated )
         return entry;
     }
 
-    UniquePtr<StoredEntry> entry = std::make_unique<StoredEntry>();
+    UniquePtr<StoredEntry> entry = std::make_unique<StoredEntry>( &m_arena );
     StoredEntry *const entryPointer = entry.get();
     entry->m_path = path;
     m_storedEntries.push_back( std::move( entry ) );
+    m_entriesByPath.emplace( path, entryPointer );
     if( outOptCreated ) *outOptCreated = true;
     return entryPointer;
 }
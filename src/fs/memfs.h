@@ -2,8 +2,16 @@
 
 #include "filesystem.h"
 
+#include <utils/arena.h>
+
+/**
+ * Temporary filesystem in memory. Content of all files lives in an arena released together with the filesystem.
+ */
 class MemFileSystem : public FileSystem
 {
+public:
+    using Content = std::vector<u8, ArenaAllocator<u8>>;
+
 public:
     MemFileSystem();
     MemFileSystem( const MemFileSystem & ) = delete;
@@ -35,18 +43,22 @@ private:
     StoredEntry *findOrCreateFileEntry( const String &path, bool *outOptCreated = nullptr );
 
 private:
-    Array<UniquePtr<StoredEntry>> m_storedEntries;
+    Arena m_arena; // declared first, outlives the content allocated from it
+    Array<UniquePtr<StoredEntry>> m_storedEntries; // in order of creation
+    UnorderedMap<String, StoredEntry *> m_entriesByPath;
 
     friend class MemFile;
 };
 
 struct MemFileSystem::StoredEntry
 {
+    StoredEntry( Arena *arena ) : m_content( ArenaAllocator<u8>( arena ) ) {}
+
     bool m_isDirectory = false;
     u32 m_openedForReadCount = 0;
     bool m_openedForWrite = false;
     String m_path;
-    Array<u8> m_content;
+    Content m_content;
 };
 
 /* eof */
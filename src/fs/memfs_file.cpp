@@ -36,17 +36,16 @@ MemFile::~MemFile()
 
 uint64_t MemFile::write( const void *buffer, uint64_t elementSize, uint64_t elementCount )
 {
-    Array<u8> &content = getContent();
+    MemFileSystem::Content &content = getContent();
     const size_t bytesToWrite = static_cast<size_t>( elementSize * elementCount );
-    const size_t offsetToWrite = content.size();
-    content.resize( offsetToWrite + bytesToWrite );
-    memcpy( content.data() + offsetToWrite, buffer, bytesToWrite );
+    const u8 *const bytes = static_cast<const u8 *>( buffer );
+    content.insert( content.end(), bytes, bytes + bytesToWrite );
     return bytesToWrite;
 }
 
 uint64_t MemFile::read( void *buffer, uint64_t elementSize, uint64_t elementCount )
 {
-    Array<u8> &content = getContent();
+    MemFileSystem::Content &content = getContent();
     const size_t bytesToRead = static_cast<size_t>( elementSize * elementCount );
     const size_t bytesLeftInContent = content.size() - static_cast<size_t>( m_readPosition );
     const size_t bytesActuallyRead = std::min( bytesToRead, bytesLeftInContent );
@@ -55,6 +54,17 @@ uint64_t MemFile::read( void *buffer, uint64_t elementSize, uint64_t elementCoun
     return bytesActuallyRead;
 }
 
+bool MemFile::readAt( void *buffer, uint64_t offset, uint64_t size )
+{
+    const MemFileSystem::Content &content = getContent();
+    if( offset > content.size() || size > content.size() - offset )
+    {
+        return false;
+    }
+    memcpy( buffer, content.data() + offset, static_cast<size_t>( size ) );
+    return true;
+}
+
 uint64_t MemFile::size()
 {
     return getContent().size();
@@ -113,4 +123,19 @@ void MemFile::mstat( MetaStat *result )
 {
 }
 
+void MemFile::reserve( uint64_t size )
+{
+    getContent().reserve( static_cast<size_t>( size ) );
+}
+
+FileView MemFile::view()
+{
+    // content of a standalone file dies with the file, copy it
+    if( !m_entry )
+    {
+        return File::view();
+    }
+    return FileView( m_entry->m_content.data(), m_entry->m_content.size() );
+}
+
 /* eof */
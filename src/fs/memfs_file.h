@@ -23,8 +23,12 @@ public:
     virtual uint64_t tell() const override;
     virtual void flush() override;
     virtual void mstat( MetaStat *result ) override;
+    virtual bool readAt( void *buffer, uint64_t offset, uint64_t size ) override;
+    virtual FileView view() override;
 
-    Array<u8> &getContent() { return m_entry ? m_entry->m_content : m_content; }
+    virtual void reserve( uint64_t size ) override;
+
+    MemFileSystem::Content &getContent() { return m_entry ? m_entry->m_content : m_content; }
 
 private:
     uint64_t m_readPosition = 0;
@@ -34,7 +38,7 @@ private:
     bool m_openedForRead = false;
 
     // When used alone
-    Array<u8> m_content;
+    MemFileSystem::Content m_content;
 };
 
 /* eof */
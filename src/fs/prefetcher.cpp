@@ -0,0 +1,251 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/prefetcher.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "prefetcher.h"
+
+Prefetcher::Prefetcher()
+	: m_budget( 64 * 1024 * 1024 )
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_stop = true;
+	}
+	m_wakeUp.notify_all();
+	for( std::thread &thread : m_threads )
+	{
+		thread.join();
+	}
+}
+
+void Prefetcher::enqueue( FileSystem &filesystem, const Array<String> &paths, Consumer consumer )
+{
+	if( !enabled() )
+	{
+		return;
+	}
+
+	Array<Request> requests;
+	requests.reserve( paths.size() );
+	for( const String &path : paths )
+	{
+		Request request;
+		if( !filesystem.locate( path, &request.m_location ) || !request.m_location.m_staged || request.m_location.m_size > m_budget / 4 )
+		{
+			continue;
+		}
+#ifdef __linux__
+		if( consumer == COPY && request.m_location.m_stored )
+		{
+			continue; // copyFile copies it inside the kernel
+		}
+#endif
+		requests.push_back( request );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		for( Request &request : requests )
+		{
+			request.m_sequence = m_nextSequence++;
+			m_pending.push_back( request );
+		}
+		while( m_threads.size() < THREAD_COUNT && !requests.empty() )
+		{
+			m_threads.emplace_back( &Prefetcher::workerMain, this );
+		}
+	}
+	m_wakeUp.notify_all();
+}
+
+bool Prefetcher::take( const FileSystem *filesystem, uint64_t offset, Array<u8> &buffer )
+{
+	if( m_stagedCount == 0 )
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	const auto it = m_staged.find( Key( filesystem, offset ) );
+	if( it == m_staged.end() )
+	{
+		return false;
+	}
+
+	const u64 sequence = it->second.m_sequence;
+	const bool staged = !it->second.m_data.empty();
+	buffer = std::move( it->second.m_data );
+	drop( it );
+
+	// consumers went past these, they are not going to be taken
+	for( auto skipped = m_staged.begin(); skipped != m_staged.end(); )
+	{
+		auto next = std::next( skipped );
+		if( skipped->second.m_sequence + SKIP_WINDOW < sequence )
+		{
+			drop( skipped );
+		}
+		skipped = next;
+	}
+
+	m_wakeUp.notify_all();
+	return staged;
+}
+
+void Prefetcher::remove( const FileSystem *filesystem )
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_pending.erase( std::remove_if( m_pending.begin(), m_pending.end(), [ filesystem ]( const Request &request )
+	{
+		return request.m_location.m_filesystem == filesystem;
+	} ), m_pending.end() );
+
+	m_idle.wait( lock, [ & ]
+	{
+		return std::find( m_reading.begin(), m_reading.end(), filesystem ) == m_reading.end();
+	} );
+
+	for( auto it = m_staged.begin(); it != m_staged.end(); )
+	{
+		auto next = std::next( it );
+		if( it->first.first == filesystem )
+		{
+			drop( it );
+		}
+		it = next;
+	}
+	m_wakeUp.notify_all();
+}
+
+void Prefetcher::setBudget( uint64_t bytes )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_budget = bytes;
+}
+
+void Prefetcher::workerMain()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	const auto ready = [ this ]
+	{
+		return m_stop || ( !m_pending.empty() && m_held < m_budget );
+	};
+	for( ;; )
+	{
+		// staged data nobody takes would hold the budget forever, it is dropped once it gets old
+		if( m_staged.empty() )
+		{
+			m_wakeUp.wait( lock, ready );
+		}
+		else
+		{
+			m_wakeUp.wait_for( lock, std::chrono::milliseconds( STAGED_LIFETIME_MS ), ready );
+			dropExpired();
+		}
+		if( m_stop )
+		{
+			return;
+		}
+		if( !ready() )
+		{
+			continue;
+		}
+
+		const Request request = m_pending.front();
+		m_pending.pop_front();
+
+		FileSystem *const filesystem = request.m_location.m_filesystem;
+		m_held += request.m_location.m_size;
+		m_reading.push_back( filesystem );
+
+		lock.unlock();
+		Array<u8> data;
+		const bool result = filesystem->prefetch( request.m_location, data );
+		lock.lock();
+
+		m_reading.erase( std::find( m_reading.begin(), m_reading.end(), filesystem ) );
+
+		const Key key( filesystem, request.m_location.m_offset );
+		const auto existing = m_staged.find( key );
+		if( existing != m_staged.end() )
+		{
+			drop( existing );
+		}
+
+		if( result && !data.empty() ) // advised reads of mapped archives hold nothing
+		{
+			m_staged.emplace( key, Staged{ std::move( data ), request.m_location.m_size, request.m_sequence, std::chrono::steady_clock::now() } );
+			++m_stagedCount;
+		}
+		else
+		{
+			m_held -= request.m_location.m_size;
+		}
+		m_idle.notify_all();
+	}
+}
+
+void Prefetcher::drop( std::unordered_map<Key, Staged, KeyHash>::iterator it )
+{
+	m_held -= it->second.m_size;
+	m_staged.erase( it );
+	--m_stagedCount;
+}
+
+void Prefetcher::dropExpired()
+{
+	const auto expired = std::chrono::steady_clock::now() - std::chrono::milliseconds( STAGED_LIFETIME_MS );
+	bool dropped = false;
+	for( auto it = m_staged.begin(); it != m_staged.end(); )
+	{
+		auto next = std::next( it );
+		if( it->second.m_stagedAt < expired )
+		{
+			drop( it );
+			dropped = true;
+		}
+		it = next;
+	}
+	if( dropped )
+	{
+		m_wakeUp.notify_all();
+	}
+}
+
+size_t Prefetcher::KeyHash::operator()( const Key &key ) const
+{
+	return std::hash<const void *>()( key.first ) ^ std::hash<uint64_t>()( key.second * 0x9E3779B97F4A7C15ull );
+}
+
+Prefetcher *getPrefetcher()
+{
+	// never destroyed, archives unregister from it during static destruction
+	static Prefetcher *const prefetcher = new Prefetcher();
+	return prefetcher;
+}
+
+/* eof */
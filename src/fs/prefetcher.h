@@ -0,0 +1,136 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/prefetcher.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include "filesystem.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <deque>
+#include <chrono>
+
+/**
+ * Reads stored data of files which are going to be opened soon on background threads.
+ * Files are read in the order they were enqueued and the bytes are kept in a bounded staging area
+ * until the archive readers take them instead of reading synchronously. Mapped archives are only
+ * advised to read the data ahead, the page cache is their staging.
+ */
+class Prefetcher
+{
+public:
+	static constexpr u32 THREAD_COUNT = 2;
+	static constexpr u64 SKIP_WINDOW = 64; // staged files this far behind the taken one are dropped
+	static constexpr u32 STAGED_LIFETIME_MS = 5000; // staged files not taken by then are dropped
+
+	/**
+	 * How the enqueued files are going to be used.
+	 */
+	enum Consumer
+	{
+		READ, // opened and read
+		COPY  // copied by copyFile, stored data may be copied inside the kernel without reading
+	};
+
+public:
+	Prefetcher();
+	Prefetcher( const Prefetcher & ) = delete;
+	Prefetcher( Prefetcher && ) = delete;
+	~Prefetcher();
+
+	Prefetcher &operator=( const Prefetcher & ) = delete;
+	Prefetcher &operator=( Prefetcher && ) = delete;
+
+	/**
+	 * Schedules files which can be located in the filesystem, see FileSystem::locate
+	 * Files whose readers would not take the staged data are skipped.
+	 */
+	void enqueue( FileSystem &filesystem, const Array<String> &paths, Consumer consumer );
+
+	/**
+	 * Removes the location from staging and moves its bytes to the buffer.
+	 * Returns false if no bytes are staged, e.g. they were only advised to be read.
+	 */
+	bool take( const FileSystem *filesystem, uint64_t offset, Array<u8> &buffer );
+
+	/**
+	 * Drops every request of the filesystem and waits for its reads in progress,
+	 * must be called before the filesystem is destroyed.
+	 */
+	void remove( const FileSystem *filesystem );
+
+	/**
+	 * Zero budget disables prefetching.
+	 */
+	void setBudget( uint64_t bytes );
+	inline bool enabled() const { return m_budget != 0; }
+
+private:
+	struct Request
+	{
+		FileSystem::Location m_location;
+		u64 m_sequence;
+	};
+
+	struct Staged
+	{
+		Array<u8> m_data;
+		uint64_t m_size;
+		u64 m_sequence;
+		std::chrono::steady_clock::time_point m_stagedAt;
+	};
+
+	using Key = Pair<const FileSystem *, uint64_t>;
+
+	struct KeyHash
+	{
+		size_t operator()( const Key &key ) const;
+	};
+
+private:
+	void workerMain();
+	void drop( std::unordered_map<Key, Staged, KeyHash>::iterator it );
+	void dropExpired();
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	std::condition_variable m_idle;
+
+	std::deque<Request> m_pending;
+	std::unordered_map<Key, Staged, KeyHash> m_staged;
+	Array<const FileSystem *> m_reading;
+	std::atomic<u32> m_stagedCount = { 0 };
+
+	uint64_t m_budget;
+	uint64_t m_held = 0; // staged and being read
+	u64 m_nextSequence = 0;
+
+	Array<std::thread> m_threads;
+	bool m_stop = false;
+};
+
+Prefetcher *getPrefetcher();
+
+/* eof */
@@ -27,6 +27,82 @@
 #include "sysfs_file.h"
 
 #include "utils/string_utils.h"
+#include "utils/thread_pool.h"
+
+#include <config.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+namespace
+{
+	struct DeferredDirectory
+	{
+		String m_path;
+		size_t m_position; // index in the result at which the subtree belongs
+	};
+
+	/**
+	 * Walks the directory opened as fd, takes ownership of the descriptor.
+	 * The entry type comes from d_type, fstatat relative to the directory is used only when the filesystem does not report it.
+	 * Subdirectories are appended to deferred instead of being walked, when deferred is given.
+	 */
+	void walkDirectory( int fd, const String &path, bool absolutePaths, bool recursive, FileSystem *filesystem, Array<FileSystem::Entry> &result, Array<DeferredDirectory> *deferred )
+	{
+		DIR *const dir = ::fdopendir( fd );
+		if( !dir )
+		{
+			::close( fd );
+			return;
+		}
+
+		while( const struct dirent *const ent = ::readdir( dir ) )
+		{
+			if( ent->d_name[ 0 ] == '.' )
+			{
+				continue;
+			}
+
+			bool isDirectory = ent->d_type == DT_DIR;
+			if( ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK )
+			{
+				struct stat st;
+				if( ::fstatat( ::dirfd( dir ), ent->d_name, &st, 0 ) == -1 )
+				{
+					continue;
+				}
+				isDirectory = S_ISDIR( st.st_mode );
+			}
+
+			String fullPath = path;
+			fullPath += '/';
+			fullPath += ent->d_name;
+
+			if( isDirectory && recursive )
+			{
+				if( deferred )
+				{
+					deferred->push_back( { fullPath, result.size() } );
+				}
+				else
+				{
+					const int subdirectory = ::openat( ::dirfd( dir ), ent->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+					if( subdirectory != -1 )
+					{
+						walkDirectory( subdirectory, fullPath, absolutePaths, recursive, filesystem, result, nullptr );
+					}
+				}
+			}
+			result.emplace_back( absolutePaths ? std::move( fullPath ) : String( ent->d_name ), isDirectory, false, filesystem );
+		}
+		::closedir( dir );
+	}
+} // namespace
+#endif
 
 SysFileSystem::SysFileSystem( const String &root )
 	: m_root( root )
@@ -118,10 +194,10 @@ bool SysFileSystem::mkdir(const String &dir)
 		if( !dirExistsStatic( dirr.substr( 0, pos ).c_str() ) )
 		{
 		#ifdef _WIN32
-			if( ::mkdir( dirr.substr( 0, pos ).c_str() ) != 0 )
+			if( ::mkdir( dirr.substr( 0, pos ).c_str() ) != 0 && errno != EEXIST ) // might be created by another thread meanwhile
 				return false;
 		#else
-			if( ::mkdir( dirr.substr( 0, pos ).c_str(), 0775 ) != 0 )
+			if( ::mkdir( dirr.substr( 0, pos ).c_str(), 0775 ) != 0 && errno != EEXIST ) // might be created by another thread meanwhile
 				return false;
 		#endif
 		}
@@ -129,6 +205,61 @@ bool SysFileSystem::mkdir(const String &dir)
 	return true;
 }
 
+bool SysFileSystem::mkdirs( Array<String> directories )
+{
+	// parent sorts before its children, so every directory is created after its parent
+	std::sort( directories.begin(), directories.end() );
+	directories.erase( std::unique( directories.begin(), directories.end() ), directories.end() );
+
+	bool result = true;
+	for( const String &dir : directories )
+	{
+		const String builtPath = buildPath( trimSlashesAtEnd( dir ) );
+	#ifdef _WIN32
+		const int status = ::mkdir( builtPath.c_str() );
+	#else
+		const int status = ::mkdir( builtPath.c_str(), 0775 );
+	#endif
+		if( status != 0 && errno != EEXIST && !mkdir( dir ) ) // parent missing, walk the whole path
+		{
+			result = false;
+		}
+	}
+	return result;
+}
+
+bool SysFileSystem::link( const String &existingPath, const String &filePath )
+{
+	const String existing = buildPath( existingPath );
+	const String target = buildPath( filePath );
+#ifdef _WIN32
+	::DeleteFileA( target.c_str() );
+	return !!::CreateHardLinkA( target.c_str(), existing.c_str(), nullptr );
+#else
+	// target may still be a link of the existing file, opening it for write would truncate both
+	::unlink( target.c_str() );
+#ifdef FICLONE
+	const int source = ::open( existing.c_str(), O_RDONLY | O_CLOEXEC );
+	if( source != -1 )
+	{
+		const int destination = ::open( target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666 );
+		const bool cloned = destination != -1 && ::ioctl( destination, FICLONE, source ) == 0;
+		if( destination != -1 )
+		{
+			::close( destination );
+		}
+		::close( source );
+		if( cloned )
+		{
+			return true;
+		}
+		::unlink( target.c_str() );
+	}
+#endif
+	return ::link( existing.c_str(), target.c_str() ) == 0;
+#endif
+}
+
 bool SysFileSystem::rmdir(const String &directory)
 {
 	return false;
@@ -181,38 +312,53 @@ auto SysFileSystem::readDir(const String &directory, bool absolutePaths, bool re
 	FindClose(dir);
 	return result;
 #else
-	auto result = std::make_unique<List<Entry>>();
-	DIR *dir;
-	struct dirent *ent;
-	struct stat st;
-
-	dir = opendir(buildPath(directoryNoSlash).c_str());
-	while ((ent = readdir(dir)) != 0)
+	const int fd = ::open( buildPath( directoryNoSlash ).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+	if( fd == -1 )
 	{
-		const String fileName = ent->d_name;
-		const String fullFileName = directoryNoSlash + "/" + fileName;
+		return UniquePtr<List<Entry>>();
+	}
 
-		if (fileName[0] == '.')
-			continue;
+	// top level subdirectories are walked in parallel, each into its own array
+	const bool parallel = recursive && Config::s_jobs > 1;
+	Array<Entry> entries;
+	Array<DeferredDirectory> subdirectories;
+	walkDirectory( fd, directoryNoSlash, absolutePaths, recursive, this, entries, parallel ? &subdirectories : nullptr );
 
-		if (stat(buildPath(fullFileName).c_str(), &st) == -1)
-			continue;
+	auto result = std::make_unique<List<Entry>>();
+	if( subdirectories.empty() )
+	{
+		result->assign( std::make_move_iterator( entries.begin() ), std::make_move_iterator( entries.end() ) );
+		return result;
+	}
 
-		const bool isDirectory = !!(st.st_mode & S_IFDIR);
-		if (isDirectory)
+	Array<Array<Entry>> subtrees( subdirectories.size() );
+	{
+		ThreadPool pool( std::min( Config::s_jobs, static_cast<u32>( subdirectories.size() ) ) );
+		for( size_t i = 0; i < subdirectories.size(); ++i )
 		{
-			if (recursive)
+			pool.push( [ this, &subdirectories, &subtrees, absolutePaths, i ]
 			{
-				auto subdir = readDir(fullFileName, absolutePaths, recursive);
-				if (subdir)
+				const String &path = subdirectories[ i ].m_path;
+				const int subdirectory = ::open( buildPath( path ).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+				if( subdirectory != -1 )
 				{
-					result->insert(result->begin(), subdir->begin(), subdir->end());
+					walkDirectory( subdirectory, path, absolutePaths, true, this, subtrees[ i ], nullptr );
 				}
-			}
+			} );
 		}
-		result->push_back(Entry((absolutePaths ? fullFileName : fileName), isDirectory, false, this));
+		pool.wait();
 	}
-	closedir(dir);
+
+	// subtrees are spliced where the serial walk would have put them, so the order does not depend on the job count
+	size_t position = 0;
+	for( size_t i = 0; i < subdirectories.size(); ++i )
+	{
+		const size_t end = subdirectories[ i ].m_position;
+		result->insert( result->end(), std::make_move_iterator( entries.begin() + position ), std::make_move_iterator( entries.begin() + end ) );
+		result->insert( result->end(), std::make_move_iterator( subtrees[ i ].begin() ), std::make_move_iterator( subtrees[ i ].end() ) );
+		position = end;
+	}
+	result->insert( result->end(), std::make_move_iterator( entries.begin() + position ), std::make_move_iterator( entries.end() ) );
 	return result;
 #endif
 }
@@ -228,6 +374,38 @@ bool SysFileSystem::mstat( MetaStat *result, const String &path )
 	else return false;
 }
 
+bool SysFileSystem::enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f )
+{
+#ifdef _WIN32
+	return false;
+#else
+	if( m_root.empty() )
+	{
+		return false;
+	}
+
+	const UniquePtr<List<Entry>> entries = readDir( "/", true, true );
+	if( !entries )
+	{
+		return false;
+	}
+
+	f( prism::city_hash_64( "", 0 ), true, 0 );
+	for( const Entry &entry : *entries )
+	{
+		const String &path = entry.GetPath();
+		f( prism::city_hash_64( path.c_str() + 1, path.length() - 1 ), entry.IsDirectory(), 0 );
+	}
+	return true;
+#endif
+}
+
+bool SysFileSystem::mstatIndexed( EntryHandle entry, MetaStat *result, const String &path )
+{
+	result->m_filesystem = this;
+	return true;
+}
+
 String SysFileSystem::getError() const
 {
 	return strerror(errno);
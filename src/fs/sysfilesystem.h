@@ -41,6 +41,25 @@ public:
 	virtual UniquePtr<List<Entry>> readDir(const String &path, bool absolutePaths, bool recursive) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
 
+	/**
+	 * Walks the whole directory tree, entries created afterwards are not enumerated.
+	 * Not supported for the global filesystem (empty root) and on Windows, where paths are case insensitive.
+	 */
+	virtual bool enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f ) override;
+	virtual bool mstatIndexed( EntryHandle entry, MetaStat *result, const String &path ) override;
+
+	/**
+	 * Creates all given directories, one mkdir per directory when the root exists.
+	 * Intended for creating the output tree once before many files are written into it.
+	 */
+	bool mkdirs( Array<String> directories );
+
+	/**
+	 * Makes filePath another name of the existing file, replacing filePath if it exists.
+	 * Tries a reflink first, which keeps the files independent, then falls back to a hardlink.
+	 */
+	bool link( const String &existingPath, const String &filePath );
+
 	String getError() const;
 
 private:
@@ -24,6 +24,10 @@
 
 #include "sysfs_file.h"
 
+#ifdef _WIN32
+#include <io.h>
+#endif
+
 SysFsFile::SysFsFile()
 {
 }
@@ -87,4 +91,61 @@ void SysFsFile::mstat( MetaStat *result )
 {
 }
 
+bool SysFsFile::readAt( void *buffer, uint64_t offset, uint64_t size )
+{
+	uint8_t *output = static_cast<uint8_t *>( buffer );
+#ifdef _WIN32
+	const HANDLE handle = reinterpret_cast<HANDLE>( ::_get_osfhandle( ::_fileno( m_fp ) ) );
+	while( size > 0 )
+	{
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>( offset );
+		overlapped.OffsetHigh = static_cast<DWORD>( offset >> 32 );
+
+		DWORD bytesRead = 0;
+		const DWORD bytesToRead = static_cast<DWORD>( std::min<uint64_t>( size, 0x40000000 ) );
+		if( !::ReadFile( handle, output, bytesToRead, &bytesRead, &overlapped ) || bytesRead == 0 )
+		{
+			return false;
+		}
+		output += bytesRead;
+		offset += bytesRead;
+		size -= bytesRead;
+	}
+#else
+	const int fd = ::fileno( m_fp );
+	while( size > 0 )
+	{
+		const ssize_t bytesRead = ::pread( fd, output, static_cast<size_t>( size ), static_cast<off_t>( offset ) );
+		if( bytesRead < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		if( bytesRead <= 0 )
+		{
+			return false;
+		}
+		output += bytesRead;
+		offset += static_cast<uint64_t>( bytesRead );
+		size -= static_cast<uint64_t>( bytesRead );
+	}
+#endif
+	return true;
+}
+
+File *SysFsFile::storage( uint64_t *offset )
+{
+	*offset = 0;
+	return this;
+}
+
+int SysFsFile::descriptor() const
+{
+#ifdef _WIN32
+	return ::_fileno( m_fp );
+#else
+	return ::fileno( m_fp );
+#endif
+}
+
 /* eof */
@@ -43,6 +43,10 @@ public:
 	virtual uint64_t tell() const override;
 	virtual void flush() override;
 	virtual void mstat( MetaStat *result ) override;
+	virtual bool readAt( void *buffer, uint64_t offset, uint64_t size ) override;
+	virtual File *storage( uint64_t *offset ) override;
+
+	int descriptor() const;
 
 private:
 	FILE *m_fp = nullptr;
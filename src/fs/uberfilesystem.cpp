@@ -26,6 +26,14 @@
 
 #include "file.h"
 
+/**
+ * Archives hash the path without leading slash, paths with slash at the end never match there
+ */
+static bool isIndexablePath( const String &path )
+{
+	return !path.empty() && path[ 0 ] == '/' && ( path.size() == 1 || path.back() != '/' );
+}
+
 UberFileSystem::UberFileSystem()
 {
 }
@@ -46,17 +54,21 @@ String UberFileSystem::name() const
 
 UniquePtr<File> UberFileSystem::open(const String &filename, FsOpenMode mode, bool *outFileExists)
 {
-	for (auto it = m_filesystems.rbegin(); it != m_filesystems.rend(); ++it)
+	UniquePtr<File> file;
+	const bool found = lookup( filename, [ & ]( FileSystem *fs, const IndexEntry *entry )
 	{
-		bool fileExists = false;
-		UniquePtr<File> file = (*it).second->open( filename, mode, &fileExists );
-		if ( fileExists )
+		if( entry )
 		{
-			if( outFileExists ) *outFileExists = true;
-			return file;
+			file = fs->openIndexed( entry->m_entry, filename, mode );
+			return true;
 		}
-	}
-	return UniquePtr<File>();
+
+		bool fileExists = false;
+		file = fs->open( filename, mode, &fileExists );
+		return fileExists;
+	} );
+	if( found && outFileExists ) *outFileExists = true;
+	return file;
 }
 
 bool UberFileSystem::remove( const String &filePath )
@@ -76,7 +88,17 @@ bool UberFileSystem::rmdir(const String &directory)
 
 bool UberFileSystem::exists(const String &filename)
 {
-	for (const auto &fs : m_filesystems)
+	const bool indexable = isIndexablePath( filename );
+	if( indexable )
+	{
+		const IndexEntry *const entry = findIndexEntry( filename );
+		if( entry && entry->m_file )
+		{
+			return true;
+		}
+	}
+
+	for (const auto &fs : indexable ? m_unindexedFileSystems : m_filesystems)
 	{
 		if (fs.second->exists(filename))
 			return true;
@@ -86,7 +108,18 @@ bool UberFileSystem::exists(const String &filename)
 
 bool UberFileSystem::dirExists(const String &dirpath)
 {
-	for (const auto &fs : m_filesystems)
+	const String path = dirpath.size() > 1 ? removeSlashAtEnd( dirpath ) : dirpath;
+	const bool indexable = isIndexablePath( path );
+	if( indexable )
+	{
+		const IndexEntry *const entry = findIndexEntry( path );
+		if( entry && entry->m_directory )
+		{
+			return true;
+		}
+	}
+
+	for (const auto &fs : indexable ? m_unindexedFileSystems : m_filesystems)
 	{
 		if (fs.second->dirExists(dirpath))
 			return true;
@@ -97,7 +130,7 @@ bool UberFileSystem::dirExists(const String &dirpath)
 auto UberFileSystem::readDir(const String &path, bool absolutePaths, bool recursive) -> UniquePtr<List<Entry>>
 {
 	UniquePtr<List<Entry>> result;
-	Map<String, int> aux;
+	UnorderedMap<String, int> aux;
 
 	for (auto it = m_filesystems.rbegin(); it != m_filesystems.rend(); ++it)
 	{
@@ -131,27 +164,54 @@ auto UberFileSystem::readDir(const String &path, bool absolutePaths, bool recurs
 
 bool UberFileSystem::mstat( MetaStat *result, const String &path )
 {
-	for( auto it = m_filesystems.rbegin(); it != m_filesystems.rend(); ++it )
+	return lookup( path, [ & ]( FileSystem *fs, const IndexEntry *entry )
 	{
-		if( ( *it ).second->mstat( result, path ) )
+		return entry ? fs->mstatIndexed( entry->m_entry, result, path ) : fs->mstat( result, path );
+	} );
+}
+
+bool UberFileSystem::locate( const String &path, Location *result )
+{
+	bool located = false;
+	lookup( path, [ & ]( FileSystem *fs, const IndexEntry *entry )
+	{
+		if( entry )
 		{
+			located = fs->locateIndexed( entry->m_entry, path, result );
 			return true;
 		}
-	}
-	return false;
+
+		// the file is located only in the filesystem which serves it
+		if( !fs->exists( path ) )
+		{
+			return false;
+		}
+		located = fs->locate( path, result );
+		return true;
+	} );
+	return located;
 }
 
 FileSystem *UberFileSystem::mount(UniquePtr<FileSystem> fs, Priority priority)
 {
 	m_ownedFileSystems.push_back( std::move( fs ) );
-	FileSystem *const fsPtr = m_ownedFileSystems.back().get();
-	m_filesystems[ priority ] = fsPtr;
-	return fsPtr;
+	return mount( m_ownedFileSystems.back().get(), priority );
 }
 
 FileSystem *UberFileSystem::mount( FileSystem *fs, Priority priority )
 {
-	m_filesystems[ priority ] = fs;
+	FileSystem *&slot = m_filesystems[ priority ];
+	const bool replaced = slot != nullptr;
+	slot = fs;
+
+	if( replaced )
+	{
+		rebuildIndex();
+	}
+	else
+	{
+		indexFileSystem( fs, priority );
+	}
 	return fs;
 }
 
@@ -169,6 +229,77 @@ void UberFileSystem::unmount(FileSystem *filesystem)
 	{
 		return fs.get() == filesystem;
 	} ), m_ownedFileSystems.end() );
+
+	rebuildIndex();
+}
+
+void UberFileSystem::indexFileSystem( FileSystem *fs, Priority priority )
+{
+	const bool indexed = fs->enumerateEntryHashes( [ & ]( u64 hash, bool directory, EntryHandle handle )
+	{
+		IndexEntry &entry = m_index[ hash ];
+		if( !entry.m_filesystem || entry.m_priority < priority )
+		{
+			entry.m_filesystem = fs;
+			entry.m_priority = priority;
+			entry.m_entry = handle;
+		}
+		( directory ? entry.m_directory : entry.m_file ) = true;
+	} );
+
+	if( !indexed )
+	{
+		m_unindexedFileSystems[ priority ] = fs;
+	}
+}
+
+void UberFileSystem::rebuildIndex()
+{
+	m_index.clear();
+	m_unindexedFileSystems.clear();
+	for( const auto &fs : m_filesystems )
+	{
+		indexFileSystem( fs.second, fs.first );
+	}
+}
+
+auto UberFileSystem::findIndexEntry( const String &path ) const -> const IndexEntry *
+{
+	if( !isIndexablePath( path ) )
+	{
+		return nullptr;
+	}
+
+	const auto it = m_index.find( prism::city_hash_64( path.c_str() + 1, path.length() - 1 ) );
+	return it != m_index.end() ? &it->second : nullptr;
+}
+
+/**
+ * Calls f( filesystem, entry ) for filesystems in priority order until it returns true.
+ * Only filesystems without index and with higher priority than the indexed winner are asked before the winner,
+ * the winner is asked last and with its index entry, the path is looked up by the filesystems otherwise (entry is nullptr).
+ */
+template< typename F >
+bool UberFileSystem::lookup( const String &path, F f )
+{
+	if( !isIndexablePath( path ) )
+	{
+		for( auto it = m_filesystems.rbegin(); it != m_filesystems.rend(); ++it )
+		{
+			if( f( it->second, nullptr ) )
+				return true;
+		}
+		return false;
+	}
+
+	const IndexEntry *const entry = findIndexEntry( path );
+	for( auto it = m_unindexedFileSystems.rbegin(); it != m_unindexedFileSystems.rend() && ( !entry || it->first > entry->m_priority ); ++it )
+	{
+		if( f( it->second, nullptr ) )
+			return true;
+	}
+
+	return entry && f( entry->m_filesystem, entry );
 }
 
 /* eof */
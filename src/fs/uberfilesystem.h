@@ -43,14 +43,37 @@ public:
 	virtual bool dirExists(const String &dirpath) override;
 	virtual UniquePtr<List<Entry>> readDir(const String &path, bool absolutePaths, bool recursive) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
+	virtual bool locate( const String &path, Location *result ) override;
 
 	FileSystem *mount(UniquePtr<FileSystem> fs, Priority priority);
 	FileSystem *mount(FileSystem *fs, Priority priority);
 	void unmount(FileSystem *fs);
 
+private:
+	/**
+	 * Merged view of all mounted filesystems able to enumerate their entries by path hash
+	 */
+	struct IndexEntry
+	{
+		FileSystem *m_filesystem = nullptr; // filesystem with the highest priority containing the entry
+		Priority m_priority = 0;
+		EntryHandle m_entry = 0; // entry in m_filesystem
+		bool m_file = false;
+		bool m_directory = false;
+	};
+
+	void indexFileSystem( FileSystem *fs, Priority priority );
+	void rebuildIndex();
+	const IndexEntry *findIndexEntry( const String &path ) const;
+
+	template< typename F > bool lookup( const String &path, F f );
+
 private:
 	std::map<Priority, FileSystem*> m_filesystems;
 	Array<UniquePtr<FileSystem>> m_ownedFileSystems;
+
+	UnorderedMap<u64, IndexEntry> m_index;
+	std::map<Priority, FileSystem*> m_unindexedFileSystems;
 };
 
 /* eof */
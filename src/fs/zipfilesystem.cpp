@@ -27,6 +27,8 @@
 #include "sysfilesystem.h"
 #include "file.h"
 #include "zipfs_file.h"
+#include "index_cache.h"
+#include "content_cache.h"
 
 #include <structs/zip.h>
 
@@ -50,6 +52,7 @@ ZipFileSystem::ZipFileSystem(const String &root)
 
 ZipFileSystem::~ZipFileSystem()
 {
+	getContentCache()->remove(this);
 }
 
 String ZipFileSystem::root() const
@@ -72,6 +75,29 @@ UniquePtr<File> ZipFileSystem::open( const String &filename, FsOpenMode mode, bo
 
 	if( outFileExists ) *outFileExists = true;
 
+	return openEntry(filename, entry);
+}
+
+UniquePtr<File> ZipFileSystem::openIndexed( EntryHandle entry, const String &filePath, FsOpenMode mode )
+{
+	return openEntry( filePath, reinterpret_cast< ZipEntry * >( static_cast< uintptr_t >( entry ) ) );
+}
+
+UniquePtr<File> ZipFileSystem::openEntry(const String &filename, ZipEntry *entry)
+{
+	if (!entry->m_directory && !resolveDataOffset(entry))
+	{
+		return UniquePtr<File>();
+	}
+
+	if (entry->m_compressed)
+	{
+		if (ContentCache::Content content = getContentCache()->find(this, entry->hash(), entry->m_offset))
+		{
+			return std::make_unique<CachedFile>(filename, this, std::move(content));
+		}
+	}
+
 	return std::make_unique<ZipFsFile>(filename, this, entry);
 }
 
@@ -209,9 +235,55 @@ bool ZipFileSystem::mstat( MetaStat *result, const String &path )
 	else return false;
 }
 
+bool ZipFileSystem::mstatIndexed( EntryHandle entry, MetaStat *result, const String &path )
+{
+	result->m_filesystem = this;
+	return true;
+}
+
+bool ZipFileSystem::locate(const String &path, Location *result)
+{
+	const ZipEntry *const entry = findEntry(path);
+	if (!entry)
+	{
+		return false;
+	}
+	return locateEntry(entry, result);
+}
+
+bool ZipFileSystem::locateIndexed( EntryHandle entry, const String &path, Location *result )
+{
+	return locateEntry( reinterpret_cast< const ZipEntry * >( static_cast< uintptr_t >( entry ) ), result );
+}
+
+bool ZipFileSystem::locateEntry(const ZipEntry *entry, Location *result)
+{
+	if (entry->m_directory)
+	{
+		return false;
+	}
+
+	// offset of the local header until the entry is opened, either orders entries the same way
+	std::lock_guard<std::mutex> lock(m_resolveMutex);
+	result->m_filesystem = this;
+	result->m_offset = entry->m_offset;
+	result->m_size = entry->m_compressedSize;
+	return true;
+}
+
+bool ZipFileSystem::enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f )
+{
+	// entries are never added once the archive is read, so their addresses serve as handles
+	for( Pair<const u64, ZipEntry> &entry : m_entries )
+	{
+		f( entry.first, entry.second.m_directory, reinterpret_cast< uintptr_t >( &entry.second ) );
+	}
+	return true;
+}
+
 bool ZipFileSystem::ioRead(void *const buffer, uint64_t bytes, uint64_t offset)
 {
-	return m_root->blockRead(buffer, offset, bytes);
+	return m_root->readAt(buffer, offset, bytes);
 }
 
 void ZipFileSystem::readZip()
@@ -222,6 +294,13 @@ void ZipFileSystem::readZip()
 	rootEntry.m_path = "/";
 	registerEntry(rootEntry);
 
+	IndexCache cache( m_rootFilename, MAKEFOURCC( 'Z', 'I', 'P', '2' ) );
+	if( cache.load() && readIndexCache( cache ) )
+	{
+		link();
+		return;
+	}
+
 	const uint64_t size = m_root->size();
 	if (size <= sizeof(zip::EndOfCentralDirectory))
 	{
@@ -229,9 +308,11 @@ void ZipFileSystem::readZip()
 		return;
 	}
 
-	uint64_t blockSizeToFindCentralDirEnd = ((size < 0x4000) ? size : 0x4000);
+	// the end record may be followed by a comment of up to 64K and preceded by the zip64 locator
+	const uint64_t maxTailSize = sizeof(zip::ZIP64EndOfCentralDirectoryLocator) + sizeof(zip::EndOfCentralDirectory) + 0xFFFF;
+	uint64_t blockSizeToFindCentralDirEnd = ((size < maxTailSize) ? size : maxTailSize);
 	UniquePtr<uint8_t[]> blockToFindCentralDirEnd(new uint8_t[static_cast<size_t>(blockSizeToFindCentralDirEnd)]);
-	if (!m_root->blockRead(blockToFindCentralDirEnd.get(), size - blockSizeToFindCentralDirEnd, blockSizeToFindCentralDirEnd))
+	if (!ioRead(blockToFindCentralDirEnd.get(), blockSizeToFindCentralDirEnd, size - blockSizeToFindCentralDirEnd))
 	{
 		error("zipfs", m_rootFilename, "Failed to read the zip::EndOfCentralDirectory structure!");
 		return;
@@ -260,60 +341,228 @@ void ZipFileSystem::readZip()
 		return;
 	}
 
-	const uint16_t numEntriesLimit = 60000;
-	if (centralDirEnd->numEntries > numEntriesLimit)
+	uint64_t numEntries = centralDirEnd->numEntries;
+	uint64_t centralDirSize = centralDirEnd->size;
+	uint64_t centralDirOffset = centralDirEnd->offset;
+
+	const size_t centralDirEndPosition = reinterpret_cast<uint8_t *>(centralDirEnd) - blockToFindCentralDirEnd.get();
+	if (centralDirEndPosition >= sizeof(zip::ZIP64EndOfCentralDirectoryLocator))
+	{
+		const zip::ZIP64EndOfCentralDirectoryLocator *const locator = reinterpret_cast<zip::ZIP64EndOfCentralDirectoryLocator *>(
+			blockToFindCentralDirEnd.get() + centralDirEndPosition - sizeof(zip::ZIP64EndOfCentralDirectoryLocator));
+		if (locator->signature == zip::ZIP64EndOfCentralDirectoryLocator::SIGNATURE)
+		{
+			zip::ZIP64EndOfCentralDirectory centralDirEnd64;
+			if (!ioRead(&centralDirEnd64, sizeof(zip::ZIP64EndOfCentralDirectory), locator->relativeOffset))
+			{
+				error("zipfs", m_rootFilename, "Failed to read the zip::ZIP64EndOfCentralDirectory structure!");
+				return;
+			}
+
+			if (centralDirEnd64.signature != zip::ZIP64EndOfCentralDirectory::SIGNATURE)
+			{
+				error("zipfs", m_rootFilename, "Invalid zip64 end signature!");
+				return;
+			}
+
+			numEntries = centralDirEnd64.centralDirTotalEntries;
+			centralDirSize = centralDirEnd64.centralDirSize;
+			centralDirOffset = centralDirEnd64.centralDirOffsetStartDisk;
+		}
+	}
+
+	if (centralDirOffset > size || centralDirSize > size - centralDirOffset)
+	{
+		error("zipfs", m_rootFilename, "Central directory is out of file bounds!");
+		return;
+	}
+
+	// central directory is read at once and parsed in memory
+	Array<u8> centralDir(static_cast<size_t>(centralDirSize));
+	if (!ioRead(centralDir.data(), centralDir.size(), centralDirOffset))
+	{
+		error("zipfs", m_rootFilename, "Failed to read central directory!");
+		return;
+	}
+
+	m_entries.reserve(static_cast<size_t>(numEntries + numEntries / 4 + 1));
+	if (!readCentralDirectory(centralDir.data(), centralDir.size(), numEntries))
 	{
-		error_f("zipfs", m_rootFilename, "The number of files(%u) exceeded limits(%u).", centralDirEnd->numEntries, numEntriesLimit);
 		return;
 	}
 
-	for (size_t e = 0, currentOffset = centralDirEnd->offset; e < centralDirEnd->numEntries; ++e)
+	link();
+
+	if( IndexCache::enabled() )
+	{
+		writeIndexCache( cache );
+	}
+}
+
+namespace
+{
+	constexpr u32 CACHE_SECTION_ENTRIES = 1;
+
+	/**
+	 * Entry record in the index cache, followed by path padded to 8 bytes
+	 */
+	struct CachedZipEntry
+	{
+		uint64_t m_offset;
+		uint64_t m_size;
+		uint64_t m_compressedSize;
+		u32 m_pathLength;
+		u8 m_directory;
+		u8 m_compressed;
+		u16 m_reserved;
+	};
+
+	inline size_t cachedZipEntrySize( size_t pathLength )
+	{
+		return sizeof( CachedZipEntry ) + ( ( pathLength + 7 ) & ~size_t( 7 ) );
+	}
+} // namespace
+
+bool ZipFileSystem::readIndexCache( const IndexCache &cache )
+{
+	uint64_t size = 0;
+	const u8 *const data = cache.section( CACHE_SECTION_ENTRIES, &size );
+	if( !data )
 	{
-		zip::CentralDirectoryFileHeader entry;
-		if (!m_root->blockRead(&entry, currentOffset, sizeof(zip::CentralDirectoryFileHeader)))
+		return false;
+	}
+
+	Array<ZipEntry> entries;
+	for( uint64_t offset = 0; offset < size; )
+	{
+		const CachedZipEntry *const cached = reinterpret_cast<const CachedZipEntry *>( data + offset );
+		if( size - offset < sizeof( CachedZipEntry ) || size - offset < cachedZipEntrySize( cached->m_pathLength ) || cached->m_pathLength == 0 )
 		{
-			error_f("zipfs", m_rootFilename, "Failed to read central directory data(%u)!", e);
-			return;
+			return false;
+		}
+
+		ZipEntry entry;
+		entry.m_path.assign( reinterpret_cast<const char *>( cached + 1 ), cached->m_pathLength );
+		entry.m_name = entry.m_path.substr( entry.m_path.find_last_of( '/' ) + 1 );
+		entry.m_directory = !!cached->m_directory;
+		entry.m_compressed = !!cached->m_compressed;
+		entry.m_offset = cached->m_offset;
+		entry.m_size = static_cast<size_t>( cached->m_size );
+		entry.m_compressedSize = static_cast<size_t>( cached->m_compressedSize );
+		entries.push_back( std::move( entry ) );
+
+		offset += cachedZipEntrySize( cached->m_pathLength );
+	}
+
+	for( const ZipEntry &entry : entries )
+	{
+		registerEntry( entry );
+	}
+	return true;
+}
+
+void ZipFileSystem::writeIndexCache( IndexCache &cache ) const
+{
+	size_t size = 0;
+	for( const Pair<const u64, ZipEntry> &entry : m_entries )
+	{
+		size += cachedZipEntrySize( entry.second.m_path.length() );
+	}
+
+	Array<u8> data( size, 0 );
+	size_t offset = 0;
+	for( const Pair<const u64, ZipEntry> &entry : m_entries )
+	{
+		const ZipEntry &e = entry.second;
+		CachedZipEntry cached;
+		cached.m_offset = e.m_offset; // written before any entry was opened, local header offset
+		cached.m_size = e.m_size;
+		cached.m_compressedSize = e.m_compressedSize;
+		cached.m_pathLength = static_cast<u32>( e.m_path.length() );
+		cached.m_directory = e.m_directory ? 1 : 0;
+		cached.m_compressed = e.m_compressed ? 1 : 0;
+		cached.m_reserved = 0;
+		memcpy( data.data() + offset, &cached, sizeof( CachedZipEntry ) );
+		memcpy( data.data() + offset + sizeof( CachedZipEntry ), e.m_path.c_str(), e.m_path.length() );
+		offset += cachedZipEntrySize( e.m_path.length() );
+	}
+
+	cache.addSection( CACHE_SECTION_ENTRIES, std::move( data ) );
+	cache.store();
+}
+
+bool ZipFileSystem::readCentralDirectory(const u8 *data, uint64_t size, uint64_t numEntries)
+{
+	uint64_t currentOffset = 0;
+	for (uint64_t e = 0; e < numEntries; ++e)
+	{
+		if (size - currentOffset < sizeof(zip::CentralDirectoryFileHeader))
+		{
+			error_f("zipfs", m_rootFilename, "Failed to read central directory data(%llu)!", e);
+			return false;
 		}
 
-		if (entry.signature != zip::CentralDirectoryFileHeader::SIGNATURE)
+		const zip::CentralDirectoryFileHeader *const entry = reinterpret_cast<const zip::CentralDirectoryFileHeader *>(data + currentOffset);
+		if (entry->signature != zip::CentralDirectoryFileHeader::SIGNATURE)
 		{
-			error_f("zipfs", m_rootFilename, "Central directory data(%u) has invalid signature!", e);
-			return;
+			error_f("zipfs", m_rootFilename, "Central directory data(%llu) has invalid signature!", e);
+			return false;
 		}
 
-		if (entry.filenameLength == 0 || entry.filenameLength > 255)
+		const uint64_t entrySize = sizeof(zip::CentralDirectoryFileHeader)
+			+ entry->filenameLength
+			+ entry->extrafieldLength
+			+ entry->fileCommentLength;
+		if (entry->filenameLength == 0 || size - currentOffset < entrySize)
 		{
-			error_f("zipfs", m_rootFilename, "Central directory data(%u) has invalid name!", e);
-			return;
+			error_f("zipfs", m_rootFilename, "Central directory data(%llu) has invalid name!", e);
+			return false;
 		}
 
-		char filenameBuffer[256] = { 0 };
-		if (!m_root->blockRead(filenameBuffer, currentOffset + sizeof(zip::CentralDirectoryFileHeader), entry.filenameLength))
+		const char *const filenameData = reinterpret_cast<const char *>(entry + 1);
+		const String filename(filenameData, strnlen(filenameData, entry->filenameLength));
+
+		if (entry->compressionMethod != zip::COMPRESSION_METHOD::STORED && entry->compressionMethod != zip::COMPRESSION_METHOD::DEFLATED)
 		{
-			error_f("zipfs", m_rootFilename, "Failed to read name of directory data(%u)!", e);
-			return;
+			error_f("zipfs", m_rootFilename, "Unsupported compression method(%s : %u)!", filename.c_str(), entry->compressionMethod);
+			return false;
 		}
-		const String filename = filenameBuffer;
 
-		if (entry.compressionMethod != zip::COMPRESSION_METHOD::STORED && entry.compressionMethod != zip::COMPRESSION_METHOD::DEFLATED)
+		uint64_t uncompressedSize = entry->uncompressedSize;
+		uint64_t compressedSize = entry->compressedSize;
+		uint64_t offset = entry->relOffsetOfLocalHeader;
+
+		// values saturated in the header are stored in the zip64 extra field, in this order
+		const u8 *extra = reinterpret_cast<const u8 *>(filenameData) + entry->filenameLength;
+		const u8 *const extraEnd = extra + entry->extrafieldLength;
+		while (extraEnd - extra >= static_cast<ptrdiff_t>(sizeof(zip::ExtraFieldHeader)))
 		{
-			error_f("zipfs", m_rootFilename, "Unsupported compression method(%s : %u)!", filename.c_str(), entry.compressionMethod);
-			return;
+			const zip::ExtraFieldHeader *const field = reinterpret_cast<const zip::ExtraFieldHeader *>(extra);
+			const u8 *value = extra + sizeof(zip::ExtraFieldHeader);
+			const u8 *const valueEnd = std::min(value + field->size, extraEnd);
+			if (field->id == zip::ExtraFieldHeader::ZIP64_EXTENDED_INFORMATION)
+			{
+				for (uint64_t *const field64 : { &uncompressedSize, &compressedSize, &offset })
+				{
+					if (*field64 == 0xFFFFFFFF && valueEnd - value >= static_cast<ptrdiff_t>(sizeof(uint64_t)))
+					{
+						memcpy(field64, value, sizeof(uint64_t));
+						value += sizeof(uint64_t);
+					}
+				}
+				break;
+			}
+			extra = valueEnd;
 		}
 
-		processEntry(trimSlashesAtEnd(trimSlashesAtBegin(filename)), &entry);
+		processEntry(trimSlashesAtEnd(trimSlashesAtBegin(filename)), entry, uncompressedSize, compressedSize, offset);
 
-		currentOffset += sizeof(zip::CentralDirectoryFileHeader)
-			+ entry.filenameLength
-			+ entry.extrafieldLength
-			+ entry.fileCommentLength;
+		currentOffset += entrySize;
 	}
-
-	link();
+	return true;
 }
 
-void ZipFileSystem::processEntry(const String &name, zip::CentralDirectoryFileHeader *entry)
+void ZipFileSystem::processEntry(const String &name, const zip::CentralDirectoryFileHeader *entry, uint64_t size, uint64_t compressedSize, uint64_t offset)
 {
 	ZipEntry zipentry;
 
@@ -330,7 +579,7 @@ void ZipFileSystem::processEntry(const String &name, zip::CentralDirectoryFileHe
 		else
 		{
 			zipentry.m_directory = false;
-			zipentry.m_offset = entry->relOffsetOfLocalHeader;
+			zipentry.m_offset = offset;
 		}
 	}
 	else if (versionMadeBy == zip::VERSION_MADE_BY::UNIX)
@@ -342,7 +591,7 @@ void ZipFileSystem::processEntry(const String &name, zip::CentralDirectoryFileHe
 		else
 		{
 			zipentry.m_directory = false;
-			zipentry.m_offset = entry->relOffsetOfLocalHeader;
+			zipentry.m_offset = offset;
 		}
 	}
 	else
@@ -366,24 +615,10 @@ void ZipFileSystem::processEntry(const String &name, zip::CentralDirectoryFileHe
 
 	if (!zipentry.m_directory)
 	{
-		zip::LocalFileHeader localEntry;
-		if (!m_root->blockRead(&localEntry, zipentry.m_offset, sizeof(zip::LocalFileHeader)))
-		{
-			error_f("zipfs", m_rootFilename, "Failed to read local file header data!");
-			return;
-		}
-
-		if (localEntry.signature != zip::LocalFileHeader::SIGNATURE)
-		{
-			error_f("zipfs", m_rootFilename, "Local file header has invalid signature!");
-			return;
-		}
-
+		// local file header is read on the first open, see resolveDataOffset
 		zipentry.m_compressed = entry->compressionMethod == zip::COMPRESSION_METHOD::DEFLATED;
-		zipentry.m_size = entry->uncompressedSize;
-		zipentry.m_compressedSize = entry->compressedSize;
-
-		zipentry.m_offset = zipentry.m_offset + sizeof(zip::LocalFileHeader) + localEntry.filenameLength + localEntry.extrafieldLength;
+		zipentry.m_size = static_cast<size_t>(size);
+		zipentry.m_compressedSize = static_cast<size_t>(compressedSize);
 	}
 	else
 	{
@@ -409,58 +644,34 @@ ZipEntry *ZipFileSystem::registerEntry(const ZipEntry &entry)
 
 void ZipFileSystem::link()
 {
-	Array<ZipEntry> toRegister;
-
-	for (Pair<const u64, ZipEntry> &entry : m_entries)
+	Array<String> paths;
+	paths.reserve(m_entries.size());
+	for (const Pair<const u64, ZipEntry> &entry : m_entries)
 	{
-		ZipEntry *const e = &entry.second;
-		if (e->m_path != "/")
-		{
-			String directory = trimSlashesAtEnd(trimSlashesAtBegin(e->m_path.substr(0, e->m_path.find_last_of('/'))));
-			ZipEntry *dir = findEntry("/" + directory);
-			if (!dir)
-			{
-				auto dirit = std::find_if(toRegister.begin(), toRegister.end(),
-					[directory](ZipEntry &e)
-					{
-						return e.path() == ("/" + directory);
-					});
-				if (dirit == toRegister.end())
-				{
-					ZipEntry newDirEntry;
-					newDirEntry.m_directory = true;
-					newDirEntry.m_name = directory.substr(directory.find_last_of('/') + 1);
-					newDirEntry.m_path = "/" + directory;
-					newDirEntry.m_compressed = false;
-					newDirEntry.m_size = 0;
-					newDirEntry.m_compressedSize = 0;
-					newDirEntry.m_offset = 0;
-					toRegister.push_back(newDirEntry);
-				}
-			}
-		}
+		paths.push_back(entry.second.m_path);
 	}
 
-	for (size_t i = 0; i < toRegister.size(); ++i)
+	// register directories which are not stored in the archive
+	for (const String &path : paths)
 	{
-		ZipEntry entry = toRegister[i];
-		if (entry.m_path != "/" && !entry.m_path.empty())
+		String directory = path;
+		while (directory != "/")
 		{
-			ZipEntry *const e = registerEntry(entry);
-			String directory = trimSlashesAtEnd(trimSlashesAtBegin(e->m_path.substr(0, e->m_path.find_last_of('/'))));
-			ZipEntry *dir = findEntry("/" + directory);
-			if (!dir)
+			directory = "/" + trimSlashesAtEnd(trimSlashesAtBegin(directory.substr(0, directory.find_last_of('/'))));
+			if (findEntry(directory))
 			{
-				ZipEntry newDirEntry;
-				newDirEntry.m_directory = true;
-				newDirEntry.m_name = directory.substr(directory.find_last_of('/') + 1);
-				newDirEntry.m_path = "/" + directory;
-				newDirEntry.m_compressed = false;
-				newDirEntry.m_size = 0;
-				newDirEntry.m_compressedSize = 0;
-				newDirEntry.m_offset = 0;
-				toRegister.push_back(newDirEntry);
+				break;
 			}
+
+			ZipEntry newDirEntry;
+			newDirEntry.m_directory = true;
+			newDirEntry.m_name = directory.substr(directory.find_last_of('/') + 1);
+			newDirEntry.m_path = directory;
+			newDirEntry.m_compressed = false;
+			newDirEntry.m_size = 0;
+			newDirEntry.m_compressedSize = 0;
+			newDirEntry.m_offset = 0;
+			registerEntry(newDirEntry);
 		}
 	}
 
@@ -472,9 +683,45 @@ void ZipFileSystem::link()
 			String directory = trimSlashesAtEnd(trimSlashesAtBegin(e->m_path.substr(0, e->m_path.find_last_of('/'))));
 			ZipEntry *dir = findEntry("/" + directory);
 			assert(dir);
-			dir->addChild(e);
+			dir->m_children.push_back(e);
 		}
 	}
+
+	for (Pair<const u64, ZipEntry> &entry : m_entries)
+	{
+		Array<ZipEntry *> &children = entry.second.m_children;
+		std::sort(children.begin(), children.end(),
+			[](const ZipEntry *a, const ZipEntry *b)
+			{
+				return a->m_name < b->m_name;
+			});
+	}
+}
+
+bool ZipFileSystem::resolveDataOffset(ZipEntry *entry)
+{
+	std::lock_guard<std::mutex> lock(m_resolveMutex);
+	if (entry->m_resolved)
+	{
+		return true;
+	}
+
+	zip::LocalFileHeader localEntry;
+	if (!ioRead(&localEntry, sizeof(zip::LocalFileHeader), entry->m_offset))
+	{
+		error_f("zipfs", m_rootFilename, "Failed to read local file header data!");
+		return false;
+	}
+
+	if (localEntry.signature != zip::LocalFileHeader::SIGNATURE)
+	{
+		error_f("zipfs", m_rootFilename, "Local file header has invalid signature!");
+		return false;
+	}
+
+	entry->m_offset = entry->m_offset + sizeof(zip::LocalFileHeader) + localEntry.filenameLength + localEntry.extrafieldLength;
+	entry->m_resolved = true;
+	return true;
 }
 
 auto ZipFileSystem::findEntry(const String &path) -> ZipEntry *
@@ -499,21 +746,4 @@ ZipEntry::~ZipEntry()
 {
 }
 
-void ZipEntry::addChild(ZipEntry *e)
-{
-	for (Array<ZipEntry *>::iterator it = m_children.begin();
-		 it != m_children.end();
-		 ++it)
-	{
-		ZipEntry *current = (*it);
-		if (e->m_name < current->m_name)
-		{
-			m_children.insert(it, e);
-			return;
-		}
-	}
-
-	m_children.push_back(e);
-}
-
 /* eof */
@@ -26,7 +26,10 @@
 
 #include <structs/zip.h>
 
+#include <mutex>
+
 class ZipEntry;
+class IndexCache;
 
 class ZipFileSystem : public FileSystem
 {
@@ -44,22 +47,35 @@ public:
 	virtual bool dirExists(const String &dirpath) override;
 	virtual UniquePtr<List<Entry>> readDir(const String &path, bool absolutePaths, bool recursive) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
+	virtual bool enumerateEntryHashes( const std::function< void( u64 hash, bool directory, EntryHandle entry ) > &f ) override;
+	virtual UniquePtr<File> openIndexed( EntryHandle entry, const String &filePath, FsOpenMode mode ) override;
+	virtual bool mstatIndexed( EntryHandle entry, MetaStat *result, const String &path ) override;
+	virtual bool locateIndexed( EntryHandle entry, const String &path, Location *result ) override;
+	virtual bool locate( const String &path, Location *result ) override;
 
 	bool ioRead(void *const buffer, uint64_t bytes, uint64_t offset);
+	inline File *device() const { return m_root.get(); }
 
 private:
 	void readZip();
-	void processEntry(const String &name, zip::CentralDirectoryFileHeader *entry);
+	bool readIndexCache( const IndexCache &cache );
+	void writeIndexCache( IndexCache &cache ) const;
+	bool readCentralDirectory(const u8 *data, uint64_t size, uint64_t numEntries);
+	void processEntry(const String &name, const zip::CentralDirectoryFileHeader *entry, uint64_t size, uint64_t compressedSize, uint64_t offset);
 	ZipEntry *registerEntry(const ZipEntry &entry);
 	void link();
+	bool resolveDataOffset(ZipEntry *entry);
 
 	ZipEntry *findEntry(const String &path);
+	UniquePtr<File> openEntry(const String &filename, ZipEntry *entry);
+	bool locateEntry(const ZipEntry *entry, Location *result);
 
 private:
 	String m_rootFilename;
 	UniquePtr<File> m_root;
 
-	Map<u64, ZipEntry> m_entries;
+	UnorderedMap<u64, ZipEntry> m_entries;
+	std::mutex m_resolveMutex;
 
 };
 
@@ -69,8 +85,8 @@ public:
 	ZipEntry();
 	~ZipEntry();
 
-	void addChild(ZipEntry *e);
 	const String &path() const { return m_path; }
+	u64 hash() const { return prism::city_hash_64(m_path.c_str() + 1, m_path.length() - 1); }
 
 private:
 	bool m_directory;
@@ -78,7 +94,8 @@ private:
 	String m_path;
 	String m_name;
 
-	uint32_t m_offset = 0;
+	uint64_t m_offset = 0; // offset of local file header, offset of data once resolved
+	bool m_resolved = false;
 
 	bool m_compressed = false;
 
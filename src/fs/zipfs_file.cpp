@@ -26,6 +26,10 @@
 
 #include "zipfilesystem.h"
 
+#include "content_cache.h"
+
+#include <utils/compression.h>
+
 ZipFsFile::ZipFsFile(const String &filepath, ZipFileSystem *filesystem, const class ZipEntry *entry)
 	: m_filepath(filepath)
 	, m_filesystem(filesystem)
@@ -60,14 +64,10 @@ uint64_t ZipFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCou
 			return 0;
 		}
 
-		if (m_filesystem->ioRead(buffer, elementSize * elementCount, m_entry->m_offset + m_position))
+		const uint64_t result = std::min(elementSize * elementCount, m_entry->m_size - m_position);
+		if (m_filesystem->ioRead(buffer, result, m_entry->m_offset + m_position))
 		{
-			uint64_t result = std::min(elementSize * elementCount, m_entry->m_size - m_position);
-			m_position += elementSize * elementCount;
-			if (m_position > m_entry->m_size)
-			{
-				m_position = m_entry->m_size;
-			}
+			m_position += result;
 			return result;
 		}
 		else
@@ -77,6 +77,11 @@ uint64_t ZipFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCou
 	}
 	else
 	{
+		if (m_position == 0 && elementSize * elementCount >= m_entry->m_size && m_entry->m_size != 0)
+		{
+			return inflateWhole(buffer);
+		}
+
 		const uint64_t chunk = 1024 * 4;
 		uint8_t inbuffer[chunk];
 		uint64_t bufferOffset = 0;
@@ -115,6 +120,7 @@ uint64_t ZipFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCou
 			assert(bufferOffset <= (elementSize * elementCount));
 			m_position += (bytes - m_stream.avail_in);
 		}
+		m_inflated += bufferOffset;
 		return bufferOffset;
 	}
 }
@@ -128,16 +134,15 @@ bool ZipFsFile::seek(uint64_t offset, Attrib attr)
 {
 	if (m_entry->m_compressed)
 	{
-		if (offset == 0 && attr == SeekSet)
+		const uint64_t target = attr == SeekSet ? offset : attr == SeekCur ? m_inflated + offset : size() - offset;
+		if (target < m_inflated || (target == 0 && m_position != 0))
 		{
-			if (m_position != 0)
-			{
-				inflateDestroy();
-				inflateInitialize();
-			}
-			return true;
+			inflateDestroy();
+			inflateInitialize();
+			m_position = 0;
+			m_inflated = 0;
 		}
-		return false; // random access is not allowed
+		return discard(target - m_inflated); // deflate stream can only be decoded forward
 	}
 	else
 	{
@@ -164,7 +169,7 @@ void ZipFsFile::rewind()
 
 uint64_t ZipFsFile::tell() const
 {
-	return m_position;
+	return m_entry->m_compressed ? m_inflated : m_position;
 }
 
 void ZipFsFile::flush()
@@ -175,6 +180,38 @@ void ZipFsFile::mstat( MetaStat *result )
 {
 }
 
+File *ZipFsFile::storage(uint64_t *offset)
+{
+	if (m_entry->m_compressed)
+	{
+		return nullptr;
+	}
+	*offset = m_entry->m_offset;
+	return m_filesystem->device();
+}
+
+uint64_t ZipFsFile::inflateWhole(void *buffer)
+{
+	Array<uint8_t> compressed(m_entry->m_compressedSize);
+	if (!m_filesystem->ioRead(compressed.data(), compressed.size(), m_entry->m_offset))
+	{
+		error("zipfs", m_filepath, "Unable to read from filesystem file");
+		return 0;
+	}
+
+	if (!unCompressWhole_deflate(buffer, m_entry->m_size, compressed.data(), compressed.size()))
+	{
+		error("zipfs", m_filepath, "Unable to decompress file");
+		return 0;
+	}
+
+	getContentCache()->insert(m_filesystem, m_entry->hash(), m_entry->m_offset, buffer, m_entry->m_size);
+
+	m_position = m_entry->m_compressedSize;
+	m_inflated = m_entry->m_size;
+	return m_entry->m_size;
+}
+
 void ZipFsFile::inflateInitialize()
 {
 	m_stream.zalloc = Z_NULL;
@@ -0,0 +1,370 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/zipwriter.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+
+#include <prerequisites.h>
+
+#include "zipwriter.h"
+#include "zipwriter_file.h"
+#include "sysfilesystem.h"
+#include "file.h"
+
+#include <structs/zip.h>
+#include <utils/compression.h>
+#include <utils/string_utils.h>
+#include <utils/thread_pool.h>
+#include <config.h>
+
+#include <ctime>
+
+namespace
+{
+	constexpr uint64_t c_pendingBudget = 256 * 1024 * 1024; // content waiting for compression
+	constexpr uint32_t c_saturated32 = 0xffffffff; // value is stored in zip64 extra field
+	constexpr uint16_t c_saturated16 = 0xffff;
+	constexpr uint16_t c_versionDefault = 20;
+	constexpr uint16_t c_versionZip64 = 45;
+
+	u32 checksum( const Array<u8> &content )
+	{
+		uLong crc = crc32( 0L, Z_NULL, 0 );
+		for( size_t offset = 0; offset < content.size(); )
+		{
+			const uInt chunk = static_cast<uInt>( std::min<size_t>( content.size() - offset, 1u << 30 ) );
+			crc = crc32( crc, content.data() + offset, chunk );
+			offset += chunk;
+		}
+		return static_cast<u32>( crc );
+	}
+
+	template< typename T >
+	void appendValue( Array<u8> &buffer, const T &value )
+	{
+		const u8 *const bytes = reinterpret_cast<const u8 *>( &value );
+		buffer.insert( buffer.end(), bytes, bytes + sizeof( T ) );
+	}
+} // namespace
+
+ZipWriterFileSystem::ZipWriterFileSystem( const String &archivePath )
+	: m_archivePath( archivePath )
+	, m_archive( getSFS()->open( archivePath, FileSystem::write | FileSystem::binary ) )
+	, m_pool( std::make_unique<ThreadPool>( Config::s_jobs ) )
+{
+	if( !m_archive )
+	{
+		error_f( "zipwriter", m_archivePath, "Unable to create archive (%s)", getSFS()->getError() );
+	}
+
+	// output paths are built by prepending the export path, entryName() strips it in this form
+	backslashesToSlashes( m_archivePath );
+
+	const time_t now = time( nullptr );
+	if( const tm *const local = localtime( &now ) )
+	{
+		m_modTime = static_cast<u16>( ( local->tm_hour << 11 ) | ( local->tm_min << 5 ) | ( local->tm_sec / 2 ) );
+		m_modDate = static_cast<u16>( ( std::max( local->tm_year - 80, 0 ) << 9 ) | ( ( local->tm_mon + 1 ) << 5 ) | local->tm_mday );
+	}
+}
+
+ZipWriterFileSystem::~ZipWriterFileSystem()
+{
+	finish();
+}
+
+String ZipWriterFileSystem::root() const
+{
+	return makeSlashAtEnd( m_archivePath );
+}
+
+String ZipWriterFileSystem::name() const
+{
+	return "zipwriter";
+}
+
+UniquePtr<File> ZipWriterFileSystem::open( const String &filePath, FsOpenMode mode, bool *outFileExists )
+{
+	assert( mode & binary ); // only binary mode is supported now
+
+	if( !( mode & write ) || ( mode & ( read | append | update ) ) || !m_archive || m_finished )
+	{
+		return nullptr; // files are only written, content of the archive cannot be read back
+	}
+	return std::make_unique<ZipWriterFile>( entryName( filePath ), this );
+}
+
+bool ZipWriterFileSystem::remove( const String &filePath )
+{
+	return false;
+}
+
+bool ZipWriterFileSystem::mkdir( const String &directory )
+{
+	return true; // directories are implied by entry names
+}
+
+bool ZipWriterFileSystem::rmdir( const String &directory )
+{
+	return false;
+}
+
+bool ZipWriterFileSystem::exists( const String &filename )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	return m_committedNames.find( entryName( filename ) ) != m_committedNames.end();
+}
+
+bool ZipWriterFileSystem::dirExists( const String &dirpath )
+{
+	return false;
+}
+
+UniquePtr<List<FileSystem::Entry>> ZipWriterFileSystem::readDir( const String &path, bool absolutePaths, bool recursive )
+{
+	return nullptr;
+}
+
+bool ZipWriterFileSystem::mstat( MetaStat *result, const String &path )
+{
+	return false;
+}
+
+bool ZipWriterFileSystem::finish()
+{
+	if( m_finished )
+	{
+		return !m_failed;
+	}
+
+	m_pool->wait();
+	m_finished = true;
+	if( !m_archive )
+	{
+		return false;
+	}
+
+	std::sort( m_entries.begin(), m_entries.end(), []( const CentralEntry &a, const CentralEntry &b ) { return a.m_name < b.m_name; } );
+	m_entryIndices.clear();
+
+	const uint64_t directoryOffset = m_offset;
+	Array<u8> directory;
+	for( const CentralEntry &entry : m_entries )
+	{
+		Array<u8> extra;
+		if( entry.m_size >= c_saturated32 ) appendValue( extra, entry.m_size );
+		if( entry.m_compressedSize >= c_saturated32 ) appendValue( extra, entry.m_compressedSize );
+		if( entry.m_offset >= c_saturated32 ) appendValue( extra, entry.m_offset );
+
+		zip::CentralDirectoryFileHeader header = {};
+		header.signature = zip::CentralDirectoryFileHeader::SIGNATURE;
+		header.versionMadeBy = extra.empty() ? c_versionDefault : c_versionZip64;
+		header.versionNeededToExtract = header.versionMadeBy;
+		header.compressionMethod = entry.m_method;
+		header.lastModTime = m_modTime;
+		header.lastModDate = m_modDate;
+		header.crc32 = entry.m_crc32;
+		header.compressedSize = static_cast<u32>( std::min<uint64_t>( entry.m_compressedSize, c_saturated32 ) );
+		header.uncompressedSize = static_cast<u32>( std::min<uint64_t>( entry.m_size, c_saturated32 ) );
+		header.filenameLength = static_cast<u16>( entry.m_name.length() );
+		header.extrafieldLength = static_cast<u16>( extra.empty() ? 0 : sizeof( zip::ExtraFieldHeader ) + extra.size() );
+		header.relOffsetOfLocalHeader = static_cast<u32>( std::min<uint64_t>( entry.m_offset, c_saturated32 ) );
+
+		appendValue( directory, header );
+		directory.insert( directory.end(), entry.m_name.begin(), entry.m_name.end() );
+		if( !extra.empty() )
+		{
+			zip::ExtraFieldHeader extraHeader;
+			extraHeader.id = zip::ExtraFieldHeader::ZIP64_EXTENDED_INFORMATION;
+			extraHeader.size = static_cast<u16>( extra.size() );
+			appendValue( directory, extraHeader );
+			directory.insert( directory.end(), extra.begin(), extra.end() );
+		}
+	}
+
+	const uint64_t directorySize = directory.size();
+	if( m_entries.size() >= c_saturated16 || directoryOffset >= c_saturated32 || directorySize >= c_saturated32 )
+	{
+		zip::ZIP64EndOfCentralDirectory end64 = {};
+		end64.signature = zip::ZIP64EndOfCentralDirectory::SIGNATURE;
+		end64.sizeOfCentralDirRecord = sizeof( end64 ) - 12; // without signature and this field
+		end64.versionMadeBy = c_versionZip64;
+		end64.versionNeededToExtract = c_versionZip64;
+		end64.centralDirEntriesOnDisk = m_entries.size();
+		end64.centralDirTotalEntries = m_entries.size();
+		end64.centralDirSize = directorySize;
+		end64.centralDirOffsetStartDisk = directoryOffset;
+
+		zip::ZIP64EndOfCentralDirectoryLocator locator = {};
+		locator.signature = zip::ZIP64EndOfCentralDirectoryLocator::SIGNATURE;
+		locator.relativeOffset = directoryOffset + directorySize;
+		locator.totalNumDisks = 1;
+
+		appendValue( directory, end64 );
+		appendValue( directory, locator );
+	}
+
+	zip::EndOfCentralDirectory end = {};
+	end.signature = zip::EndOfCentralDirectory::SIGNATURE;
+	end.startOffset = static_cast<u16>( std::min<size_t>( m_entries.size(), c_saturated16 ) );
+	end.numEntries = end.startOffset;
+	end.size = static_cast<u32>( std::min<uint64_t>( directorySize, c_saturated32 ) );
+	end.offset = static_cast<u32>( std::min<uint64_t>( directoryOffset, c_saturated32 ) );
+	appendValue( directory, end );
+
+	if( !m_archive->blockWrite( directory.data(), directory.size() ) )
+	{
+		error( "zipwriter", m_archivePath, "Unable to write central directory!" );
+		m_failed = true;
+	}
+	m_archive.reset();
+	return !m_failed;
+}
+
+String ZipWriterFileSystem::entryName( const String &path ) const
+{
+	String name = path;
+	backslashesToSlashes( name );
+	if( name.compare( 0, m_archivePath.length(), m_archivePath ) == 0 && name.length() > m_archivePath.length() && name[ m_archivePath.length() ] == '/' )
+	{
+		name = name.substr( m_archivePath.length() );
+	}
+	return trimSlashesAtBegin( name );
+}
+
+void ZipWriterFileSystem::commit( const String &name, Array<u8> &&content )
+{
+	u64 sequence;
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_released.wait( lock, [ & ] { return m_pendingBytes == 0 || m_pendingBytes + content.size() <= c_pendingBudget; } );
+		sequence = m_committed++;
+		m_pendingBytes += content.size();
+		m_committedNames[ name ] = sequence;
+	}
+	m_pool->push( [ this, sequence, name, content = std::move( content ) ]() mutable { compress( sequence, name, std::move( content ) ); } );
+}
+
+void ZipWriterFileSystem::compress( u64 sequence, const String &name, Array<u8> &&content )
+{
+	CompressedFile file;
+	file.m_name = name;
+	file.m_size = content.size();
+	file.m_crc32 = checksum( content );
+	file.m_method = zip::COMPRESSION_METHOD::STORED;
+
+	// dds data is block compressed already, deflating it costs a lot for few percent
+	const Optional<String> extension = extractExtension( name );
+	if( !content.empty() && !( extension.has_value() && extension.value() == ".dds" ) )
+	{
+		file.m_data.resize( content.size() );
+		const uint64_t compressedSize = compressWhole_deflate( file.m_data.data(), file.m_data.size(), content.data(), content.size() );
+		if( compressedSize > 0 && compressedSize < content.size() )
+		{
+			file.m_data.resize( static_cast<size_t>( compressedSize ) );
+			file.m_method = zip::COMPRESSION_METHOD::DEFLATED;
+		}
+	}
+	if( file.m_method == zip::COMPRESSION_METHOD::STORED )
+	{
+		file.m_data = std::move( content );
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_waiting.emplace( sequence, std::move( file ) );
+	for( auto it = m_waiting.find( m_written ); it != m_waiting.end(); it = m_waiting.find( m_written ) )
+	{
+		writeCompressed( it->second );
+		m_pendingBytes -= it->second.m_size;
+		m_waiting.erase( it );
+		++m_written;
+	}
+	m_released.notify_all();
+}
+
+void ZipWriterFileSystem::writeCompressed( const CompressedFile &file )
+{
+	if( m_failed )
+	{
+		return;
+	}
+
+	const bool zip64 = file.m_size >= c_saturated32 || file.m_data.size() >= c_saturated32;
+
+	zip::LocalFileHeader header = {};
+	header.signature = zip::LocalFileHeader::SIGNATURE;
+	header.versionNeededToExtract = zip64 ? c_versionZip64 : c_versionDefault;
+	header.compressionMethod = file.m_method;
+	header.lastModTime = m_modTime;
+	header.lastModDate = m_modDate;
+	header.crc32 = file.m_crc32;
+	header.compressedSize = zip64 ? c_saturated32 : static_cast<u32>( file.m_data.size() );
+	header.uncompressedSize = zip64 ? c_saturated32 : static_cast<u32>( file.m_size );
+	header.filenameLength = static_cast<u16>( file.m_name.length() );
+
+	Array<u8> headers;
+	if( zip64 )
+	{
+		header.extrafieldLength = sizeof( zip::ExtraFieldHeader ) + 2 * sizeof( uint64_t );
+		zip::ExtraFieldHeader extraHeader;
+		extraHeader.id = zip::ExtraFieldHeader::ZIP64_EXTENDED_INFORMATION;
+		extraHeader.size = 2 * sizeof( uint64_t );
+		appendValue( headers, header );
+		headers.insert( headers.end(), file.m_name.begin(), file.m_name.end() );
+		appendValue( headers, extraHeader );
+		appendValue( headers, file.m_size );
+		appendValue( headers, static_cast<uint64_t>( file.m_data.size() ) );
+	}
+	else
+	{
+		appendValue( headers, header );
+		headers.insert( headers.end(), file.m_name.begin(), file.m_name.end() );
+	}
+
+	if( !m_archive->blockWrite( headers.data(), headers.size() ) || !m_archive->blockWrite( file.m_data.data(), file.m_data.size() ) )
+	{
+		error_f( "zipwriter", m_archivePath, "Unable to write \'%s\' into the archive!", file.m_name );
+		m_failed = true;
+		return;
+	}
+
+	CentralEntry entry;
+	entry.m_name = file.m_name;
+	entry.m_size = file.m_size;
+	entry.m_compressedSize = file.m_data.size();
+	entry.m_offset = m_offset;
+	entry.m_crc32 = file.m_crc32;
+	entry.m_method = file.m_method;
+	m_offset += headers.size() + file.m_data.size();
+
+	// a file written again replaces the previous entry, its data stays in the archive unreferenced
+	const auto found = m_entryIndices.find( entry.m_name );
+	if( found != m_entryIndices.end() )
+	{
+		m_entries[ found->second ] = std::move( entry );
+	}
+	else
+	{
+		m_entryIndices.emplace( entry.m_name, m_entries.size() );
+		m_entries.push_back( std::move( entry ) );
+	}
+}
+
+/* eof */
@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/zipwriter.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+
+#pragma once
+
+#include "filesystem.h"
+
+#include <mutex>
+#include <condition_variable>
+
+class ThreadPool;
+
+/**
+ * Write-only filesystem packing every written file into a single zip archive.
+ * A file is held in memory until it is closed, then it is compressed on a worker thread
+ * and appended to the archive in the order the files were closed. With parallel jobs that order depends on scheduling,
+ * the central directory is written once by finish() sorted by name, so at least the listing is the same for every job count.
+ * Paths may be prefixed with the archive path, as conversion builds output paths by prepending the export path.
+ */
+class ZipWriterFileSystem : public FileSystem
+{
+public:
+	ZipWriterFileSystem( const String &archivePath );
+	virtual ~ZipWriterFileSystem();
+
+	virtual String root() const override;
+	virtual String name() const override;
+	virtual UniquePtr<File> open( const String &filePath, FsOpenMode mode, bool *outFileExists = nullptr ) override;
+	virtual bool remove( const String &filePath ) override;
+	virtual bool mkdir( const String &directory ) override;
+	virtual bool rmdir( const String &directory ) override;
+	virtual bool exists( const String &filename ) override;
+	virtual bool dirExists( const String &dirpath ) override;
+	virtual UniquePtr<List<Entry>> readDir( const String &path, bool absolutePaths, bool recursive ) override;
+	virtual bool mstat( MetaStat *result, const String &path ) override;
+
+	inline bool good() const { return m_archive != nullptr; }
+
+	/**
+	 * Waits for the files being compressed and writes the central directory.
+	 * Returns false if writing of any file failed.
+	 */
+	bool finish();
+
+private:
+	struct CompressedFile
+	{
+		String m_name;
+		Array<u8> m_data; // stored data, content itself when not compressed
+		uint64_t m_size = 0;
+		u32 m_crc32 = 0;
+		u16 m_method = 0;
+	};
+
+	struct CentralEntry
+	{
+		String m_name;
+		uint64_t m_size = 0;
+		uint64_t m_compressedSize = 0;
+		uint64_t m_offset = 0; // of local file header
+		u32 m_crc32 = 0;
+		u16 m_method = 0;
+	};
+
+private:
+	String entryName( const String &path ) const;
+
+	/**
+	 * Takes content of the closed file, blocks while too much content waits for compression.
+	 */
+	void commit( const String &name, Array<u8> &&content );
+	void compress( u64 sequence, const String &name, Array<u8> &&content );
+	void writeCompressed( const CompressedFile &file );
+
+private:
+	String m_archivePath;
+	UniquePtr<File> m_archive;
+	UniquePtr<ThreadPool> m_pool;
+	u16 m_modTime = 0;
+	u16 m_modDate = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_released;
+	u64 m_committed = 0; // sequence number of the next closed file
+	u64 m_written = 0; // sequence number of the next file to be appended
+	Map<u64, CompressedFile> m_waiting; // compressed, waiting for the preceding files
+	uint64_t m_pendingBytes = 0; // content committed but not appended yet
+	uint64_t m_offset = 0;
+	Array<CentralEntry> m_entries;
+	UnorderedMap<String, size_t> m_entryIndices;
+	UnorderedMap<String, u64> m_committedNames; // entry name -> sequence number, known before the file is appended
+	bool m_failed = false;
+	bool m_finished = false;
+
+	friend class ZipWriterFile;
+};
+
+/* eof */
@@ -0,0 +1,85 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/zipwriter_file.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+
+#include <prerequisites.h>
+
+#include "zipwriter_file.h"
+#include "zipwriter.h"
+
+ZipWriterFile::ZipWriterFile( const String &name, ZipWriterFileSystem *filesystem )
+	: m_name( name )
+	, m_filesystem( filesystem )
+{
+}
+
+ZipWriterFile::~ZipWriterFile()
+{
+	m_filesystem->commit( m_name, std::move( m_content ) );
+}
+
+uint64_t ZipWriterFile::write( const void *buffer, uint64_t elementSize, uint64_t elementCount )
+{
+	const size_t bytesToWrite = static_cast<size_t>( elementSize * elementCount );
+	const u8 *const bytes = static_cast<const u8 *>( buffer );
+	m_content.insert( m_content.end(), bytes, bytes + bytesToWrite );
+	return bytesToWrite;
+}
+
+uint64_t ZipWriterFile::read( void *buffer, uint64_t elementSize, uint64_t elementCount )
+{
+	return 0;
+}
+
+uint64_t ZipWriterFile::size()
+{
+	return m_content.size();
+}
+
+bool ZipWriterFile::seek( uint64_t offset, Attrib attr )
+{
+	return false;
+}
+
+void ZipWriterFile::rewind()
+{
+}
+
+uint64_t ZipWriterFile::tell() const
+{
+	return m_content.size();
+}
+
+void ZipWriterFile::flush()
+{
+}
+
+void ZipWriterFile::mstat( MetaStat *result )
+{
+}
+
+void ZipWriterFile::reserve( uint64_t size )
+{
+	m_content.reserve( static_cast<size_t>( size ) );
+}
+
+/* eof */
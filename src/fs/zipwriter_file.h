@@ -0,0 +1,60 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/zipwriter_file.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+
+#pragma once
+
+#include "file.h"
+
+class ZipWriterFileSystem;
+
+/**
+ * File opened for write in ZipWriterFileSystem, its content is passed to the archive when the file is destroyed.
+ */
+class ZipWriterFile : public File
+{
+public:
+	ZipWriterFile( const String &name, ZipWriterFileSystem *filesystem );
+	ZipWriterFile( const ZipWriterFile & ) = delete;
+	ZipWriterFile( ZipWriterFile && ) = delete;
+	virtual ~ZipWriterFile();
+
+	ZipWriterFile &operator=( const ZipWriterFile & ) = delete;
+	ZipWriterFile &operator=( ZipWriterFile && ) = delete;
+
+	virtual uint64_t write( const void *buffer, uint64_t elementSize, uint64_t elementCount ) override;
+	virtual uint64_t read( void *buffer, uint64_t elementSize, uint64_t elementCount ) override;
+	virtual uint64_t size() override;
+	virtual bool seek( uint64_t offset, Attrib attr ) override;
+	virtual void rewind() override;
+	virtual uint64_t tell() const override;
+	virtual void flush() override;
+	virtual void mstat( MetaStat *result ) override;
+	virtual void reserve( uint64_t size ) override;
+
+private:
+	String m_name;
+	ZipWriterFileSystem *m_filesystem;
+	Array<u8> m_content;
+};
+
+/* eof */
@@ -80,22 +80,15 @@ void Material::destroy()
 bool Material::load(String filePath)
 {
 	m_filePath = filePath;
-	auto file = getUFS()->open(m_filePath, FileSystem::read | FileSystem::binary);
+	const FileView file = getUFS()->openView(m_filePath);
 	if(!file)
 	{
 		warning_f("material", m_filePath, "Unable to open material!");
 		return false;
 	}
 
-	size_t fileSize = static_cast<size_t>(file->size());
-
-	uint8_t *buff = new uint8_t[fileSize + 1]; // +1 for null terminator
-	file->read((char *)buff, sizeof(uint8_t), fileSize);
-	file.reset();
-
-	buff[fileSize] = '\0';
-	String buffer = (char *)buff;
-	delete[] buff;
+	const char *const content = reinterpret_cast<const char *>(file.data());
+	String buffer(content, strnlen(content, file.size())); // up to null terminator
 
 	size_t begin_material = buffer.find(':'); // material : "effect" { }
 	if (begin_material == String::npos)
@@ -198,18 +191,6 @@ void Material::setAlias(String name)
 	m_alias = name;
 }
 
-bool Material::convertTextures(String exportPath) const
-{
-	for (auto &texture : m_textures)
-	{
-		if (texture.texobj())
-		{
-			texture.texobj()->saveToMidFormats(exportPath);
-		}
-	}
-	return true;
-}
-
 void Material::setValues(Material::Attribute &attrib, const Array<String> &values, const int startIndex)
 {
 	/**
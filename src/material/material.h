@@ -69,8 +69,6 @@ public:
 
 	void setAlias(String name);
 
-	bool convertTextures(String exportPath) const;
-
 	static void setValues(Material::Attribute &attrib, const Array<String> &values, const int startIndex = 0);
 
 	using AttributesMap = Map<String, Attribute>;
@@ -94,27 +94,25 @@ bool Animation::load(SharedPtr<Model> model, String filePath)
 	}
 
 	const String pmaFilepath = m_filePath + ".pma";
-	UniquePtr<File> file = getUFS()->open(pmaFilepath, FileSystem::read | FileSystem::binary);
+	const FileView file = getUFS()->openView(pmaFilepath);
 	if (!file)
 	{
 		error("animation", m_filePath, "Cannot open animation file!");
 		return false;
 	}
 
-	size_t fileSize = static_cast<size_t>(file->size());
-	UniquePtr<uint8_t[]> buffer(new uint8_t[fileSize]);
-	file->read((char *)buffer.get(), sizeof(uint8_t), fileSize);
-	file.reset();
+	const uint8_t *const buffer = file.data();
+	const size_t fileSize = file.size();
 
-	switch ((u8)buffer.get()[0])
+	switch ((u8)buffer[0])
 	{
-		case 0x03: return loadAnim<pma_0x03::pma_header_t, pma_0x03::pma_frame_t>(buffer.get(), fileSize);
-		case 0x04: return loadAnim<pma_0x04::pma_header_t, pma_0x04::pma_frame_t>(buffer.get(), fileSize);
-		case 0x05: return loadAnim<pma_0x05::pma_header_t, pma_0x05::pma_frame_t>(buffer.get(), fileSize);
+		case 0x03: return loadAnim<pma_0x03::pma_header_t, pma_0x03::pma_frame_t>(buffer, fileSize);
+		case 0x04: return loadAnim<pma_0x04::pma_header_t, pma_0x04::pma_frame_t>(buffer, fileSize);
+		case 0x05: return loadAnim<pma_0x05::pma_header_t, pma_0x05::pma_frame_t>(buffer, fileSize);
 	}
 
 	error_f("animation", m_filePath, "Invalid version of the file (have: %i, expected: %i, %i or %i)",
-		buffer.get()[0], pma_0x03::pma_header_t::SUPPORTED_VERSION, pma_0x04::pma_header_t::SUPPORTED_VERSION, pma_0x05::pma_header_t::SUPPORTED_VERSION);
+		buffer[0], pma_0x03::pma_header_t::SUPPORTED_VERSION, pma_0x04::pma_header_t::SUPPORTED_VERSION, pma_0x05::pma_header_t::SUPPORTED_VERSION);
 
 	return false;
 }
@@ -122,7 +120,7 @@ bool Animation::load(SharedPtr<Model> model, String filePath)
 void Animation::saveToPia(String exportPath) const
 {
 	const String piafile = exportPath + m_filePath + ".pia";
-	UniquePtr<File> file = getSFS()->open(piafile, FileSystem::write | FileSystem::binary);
+	UniquePtr<File> file = getOutputFS()->open(piafile, FileSystem::write | FileSystem::binary);
 	if (!file)
 	{
 		error_f("animation", piafile, "Unable to save file (%s)", getSFS()->getError());
@@ -35,19 +35,17 @@ bool Collision::load(Model *const model, String filePath)
 	m_model = model;
 
 	const String pmcPath = m_filePath + ".pmc";
-	auto file = getUFS()->open(pmcPath, FileSystem::read | FileSystem::binary);
+	const FileView file = getUFS()->openView(pmcPath);
 	if (!file)
 	{
 		error("collision", m_filePath, "Unable to open collision file!");
 		return false;
 	}
 
-	const size_t fileSize = static_cast<size_t>(file->size());
-	UniquePtr<uint8_t[]> buffer(new uint8_t[fileSize]);
-	file->read((char *)buffer.get(), sizeof(char), fileSize);
-	file.reset();
+	const uint8_t *const buffer = file.data();
+	const size_t fileSize = file.size();
 
-	const auto header = reinterpret_cast<prism::pmc_header_t *>(buffer.get());
+	const auto header = reinterpret_cast<const prism::pmc_header_t *>(buffer);
 	if (header->m_version != prism::pmc_header_t::SUPPORTED_VERSION)
 	{
 		error_f("collision", m_filePath, "Invalid version of collision file! (have: %i expected: %i)", header->m_version, prism::pmc_header_t::SUPPORTED_VERSION);
@@ -56,18 +54,18 @@ bool Collision::load(Model *const model, String filePath)
 
 	for (size_t i = 0; i < header->m_piece_count; ++i)
 	{
-		const auto piecef = reinterpret_cast<prism::pmc_piece_t *>(buffer.get() + header->m_piece_offset) + i;
+		const auto piecef = reinterpret_cast<const prism::pmc_piece_t *>(buffer + header->m_piece_offset) + i;
 
 		Piece piece;
 		piece.m_verts.resize(piecef->m_verts);
 		for (size_t v = 0; v < piece.m_verts.size(); ++v)
 		{
-			piece.m_verts[v] = *(reinterpret_cast<prism::float3 *>(buffer.get() + piecef->m_vert_offset) + v);
+			piece.m_verts[v] = *(reinterpret_cast<const prism::float3 *>(buffer + piecef->m_vert_offset) + v);
 		}
 		piece.m_triangles.resize(piecef->m_edges / 3);
 		for (size_t t = 0; t < piece.m_triangles.size(); ++t)
 		{
-			piece.m_triangles[t] = *(reinterpret_cast<prism::pmc_triangle_t *>(buffer.get() + piecef->m_face_offset) + t);
+			piece.m_triangles[t] = *(reinterpret_cast<const prism::pmc_triangle_t *>(buffer + piecef->m_face_offset) + t);
 		}
 		m_vertCount += piece.m_verts.size();
 		m_triangleCount += piece.m_triangles.size();
@@ -76,8 +74,8 @@ bool Collision::load(Model *const model, String filePath)
 
 	for (size_t i = 0; i < header->m_variant_count; ++i)
 	{
-		const auto variantName = reinterpret_cast<prism::pmc_variant_t *>(buffer.get() + header->m_variant_offset) + i;
-		const auto variantDef = reinterpret_cast<prism::pmc_variant_def_t *>(buffer.get() + header->m_variant_def_offset) + i;
+		const auto variantName = reinterpret_cast<const prism::pmc_variant_t *>(buffer + header->m_variant_offset) + i;
+		const auto variantDef = reinterpret_cast<const prism::pmc_variant_def_t *>(buffer + header->m_variant_def_offset) + i;
 
 		Variant variant;
 		variant.m_name = variantName->m_name.to_string();
@@ -86,7 +84,7 @@ bool Collision::load(Model *const model, String filePath)
 		{
 			assert((variantDef->m_offset + currentOffset) < fileSize);
 
-			const auto locatorf = reinterpret_cast<prism::pmc_locator_t *>(buffer.get() + variantDef->m_offset + currentOffset);
+			const auto locatorf = reinterpret_cast<const prism::pmc_locator_t *>(buffer + variantDef->m_offset + currentOffset);
 			if (locatorf->m_data_size == -1)
 				break;
 
@@ -112,7 +110,7 @@ bool Collision::load(Model *const model, String filePath)
 				case sizeof(prism::pmc_locator_convex_t):
 				{
 					auto loc = std::make_shared<ConvexLocator>();
-					const auto locf = static_cast<prism::pmc_locator_convex_t *>(locatorf);
+					const auto locf = static_cast<const prism::pmc_locator_convex_t *>(locatorf);
 					loc->m_rotation = locf->m_rotation;
 					loc->m_convexPiece = locf->m_convex_piece;
 					locator = std::move(loc);
@@ -120,7 +118,7 @@ bool Collision::load(Model *const model, String filePath)
 				case sizeof(prism::pmc_locator_cylinder_t):
 				{
 					auto loc = std::make_shared<CylinderLocator>();
-					const auto locf = static_cast<prism::pmc_locator_cylinder_t *>(locatorf);
+					const auto locf = static_cast<const prism::pmc_locator_cylinder_t *>(locatorf);
 					loc->m_rotation = locf->m_rotation;
 					loc->m_radius = locf->m_radius;
 					loc->m_depth = locf->m_depth;
@@ -129,7 +127,7 @@ bool Collision::load(Model *const model, String filePath)
 				case sizeof(prism::pmc_locator_box_t):
 				{
 					auto loc = std::make_shared<BoxLocator>();
-					const auto locf = static_cast<prism::pmc_locator_box_t *>(locatorf);
+					const auto locf = static_cast<const prism::pmc_locator_box_t *>(locatorf);
 					loc->m_rotation = locf->m_rotation;
 					loc->m_scale = locf->m_scale;
 					locator = std::move(loc);
@@ -137,7 +135,7 @@ bool Collision::load(Model *const model, String filePath)
 				case sizeof(prism::pmc_locator_sphere_t):
 				{
 					auto loc = std::make_shared<SphereLocator>();
-					const auto locf = static_cast<prism::pmc_locator_sphere_t *>(locatorf);
+					const auto locf = static_cast<const prism::pmc_locator_sphere_t *>(locatorf);
 					loc->m_radius = locf->m_radius;
 					locator = std::move(loc);
 				} break;
@@ -229,7 +227,7 @@ void Collision::assignPartToLocator(const SharedPtr<Locator> &loc, const size_t
 bool Collision::saveToPic(String exportPath) const
 {
 	const String picFilePath = exportPath + m_filePath + ".pic";
-	auto file = getSFS()->open(picFilePath, FileSystem::write | FileSystem::binary);
+	auto file = getOutputFS()->open(picFilePath, FileSystem::write | FileSystem::binary);
 	if (!file)
 	{
 		error_f("collision", picFilePath, "Unable to save file! (%s)", getSFS()->getError());
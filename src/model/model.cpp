@@ -31,6 +31,9 @@
 #include <pix/pix.h>
 #include <resource_lib.h>
 #include <texture/texture.h>
+#include <texture/texture_object.h>
+#include <utils/thread_pool.h>
+#include <config.h>
 #include <prefab/prefab.h>
 #include <model/collision.h>
 
@@ -48,6 +51,7 @@ Model::Model()
 
 Model::~Model()
 {
+	releaseTextureArtifacts();
 }
 
 bool Model::load(String filePath)
@@ -71,6 +75,8 @@ bool Model::load(String filePath)
 
 void Model::destroy()
 {
+	releaseTextureArtifacts();
+
 	m_bones.clear();
 	m_locators.clear();
 	m_parts.clear();
@@ -91,28 +97,32 @@ void Model::destroy()
 bool Model::loadModel()
 {
 	String pmgPath = m_filePath + ".pmg";
-	auto file = getUFS()->open(pmgPath, FileSystem::read | FileSystem::binary);
+	const FileView file = getUFS()->openView(pmgPath);
 	if (!file)
 	{
 		error_f("model", m_filePath, "Unable to open geometry file [.pmg] (%s)!", strerror(errno));
 		return false;
 	}
 
-	const size_t fileSize = static_cast<size_t>(file->size());
-	UniquePtr<uint8_t[]> buffer(new uint8_t[fileSize]);
-	file->read((char *)buffer.get(), sizeof(char), fileSize);
-	file.reset();
+	const uint8_t *const buffer = file.data();
+	const size_t fileSize = file.size();
 
-	const auto version = *(const u32 *)(buffer.get());
+	if (fileSize < sizeof(u32))
+	{
+		error("model", m_filePath, "Geometry file is malformed!");
+		return false;
+	}
+
+	const auto version = *(const u32 *)(buffer);
 	switch (version)
 	{
-		case MAKEFOURCC(0x13, 'g', 'm', 'P'): return loadModel0x13(buffer.get(), fileSize);
-		case MAKEFOURCC(0x14, 'g', 'm', 'P'): return loadModel0x14(buffer.get(), fileSize);
-		case MAKEFOURCC(0x15, 'g', 'm', 'P'): return loadModel0x15(buffer.get(), fileSize);
+		case MAKEFOURCC(0x13, 'g', 'm', 'P'): return loadModel0x13(buffer, fileSize);
+		case MAKEFOURCC(0x14, 'g', 'm', 'P'): return loadModel0x14(buffer, fileSize);
+		case MAKEFOURCC(0x15, 'g', 'm', 'P'): return loadModel0x15(buffer, fileSize);
 	}
 
 	error_f("model", m_filePath, "Invalid version of geometry file (have: %i signature: %c%c%c, expected: %i, %i or %i)",
-			buffer.get()[0], buffer.get()[3], buffer.get()[2], buffer.get()[1],
+			buffer[0], buffer[3], buffer[2], buffer[1],
 			pmg_0x13::pmg_header_t::SUPPORTED_VERSION, pmg_0x14::pmg_header_t::SUPPORTED_VERSION, pmg_0x15::pmg_header_t::SUPPORTED_VERSION);
 
 	return false;
@@ -782,17 +792,15 @@ bool Model::loadDescriptor()
 {
 	const String pmdPath = m_filePath + ".pmd";
 
-	auto file = getUFS()->open(pmdPath, FileSystem::read | FileSystem::binary);
+	const FileView file = getUFS()->openView(pmdPath);
 	if(!file)
 	{
 		error_f("model", m_filePath, "Unable to open descriptor file [.pmd] (%s)!", strerror(errno));
 		return false;
 	}
 
-	const size_t fileSize = static_cast<size_t>(file->size());
-	UniquePtr<uint8_t[]> buffer(new uint8_t[fileSize]);
-	file->read((char *)buffer.get(), sizeof(uint8_t), fileSize);
-	file.reset();
+	const uint8_t *const buffer = file.data();
+	const size_t fileSize = file.size();
 
 	if (fileSize < sizeof(pmd_header_t))
 	{
@@ -800,7 +808,7 @@ bool Model::loadDescriptor()
 		return false;
 	}
 
-	const auto header = (pmd_header_t *)(buffer.get());
+	const auto header = (pmd_header_t *)(buffer);
 	if (header->m_version != pmd_header_t::SUPPORTED_VERSION)
 	{
 		error_f("model", m_filePath, "Invalid version of descriptor file! (have: %i, expected: %i)", header->m_version, pmd_header_t::SUPPORTED_VERSION);
@@ -813,15 +821,15 @@ bool Model::loadDescriptor()
 	for (uint32_t i = 0; i < m_looks.size(); ++i)
 	{
 		Look *currentLook = &m_looks[i];
-		token_t currentNameLook = *(token_t *)(buffer.get() + header->m_look_offset + i*sizeof(token_t));
+		token_t currentNameLook = *(token_t *)(buffer + header->m_look_offset + i*sizeof(token_t));
 
 		currentLook->m_name = token_to_string(currentNameLook);
 		currentLook->m_materials.resize(header->m_material_count);
 		for (uint32_t j = 0; j < header->m_material_count; ++j)
 		{
 			uint32_t currentOffsetMat = ((i*header->m_material_count) + j)*sizeof(uint32_t);
-			uint32_t offsetMaterial = *(uint32_t *)(buffer.get() + header->m_material_offset + currentOffsetMat);
-			const char *materialPath = (const char *)(buffer.get() + offsetMaterial);
+			uint32_t offsetMaterial = *(uint32_t *)(buffer + header->m_material_offset + currentOffsetMat);
+			const char *materialPath = (const char *)(buffer + offsetMaterial);
 			currentLook->m_materials[j].load(materialPath[0] == '/' ? materialPath : (m_directory + "/" + materialPath));
 			if (i == 0)
 			{
@@ -854,7 +862,7 @@ bool Model::loadDescriptor()
 	for (uint32_t i = 0; i < m_variants.size(); ++i)
 	{
 		Variant *variant = &m_variants[i];
-		token_t variantName = *((token_t *)(buffer.get() + header->m_variant_offset) + i);
+		token_t variantName = *((token_t *)(buffer + header->m_variant_offset) + i);
 
 		variant->m_name = variantName.to_string();
 		variant->setPartCount(header->m_part_count);
@@ -862,11 +870,11 @@ bool Model::loadDescriptor()
 		for (uint32_t j = 0; j < header->m_part_count; ++j)
 		{
 			(*variant)[j].m_part = &m_parts[j];
-			const auto attribLink = (pmd_attrib_link_t *)(buffer.get() + header->m_part_attribs_offset) + j;
+			const auto attribLink = (pmd_attrib_link_t *)(buffer + header->m_part_attribs_offset) + j;
 			for (int32_t k = attribLink->m_from; k < attribLink->m_to; ++k)
 			{
-				const auto attribDef = (pmd_attrib_def_t *)(buffer.get() + header->m_attribs_offset) + k;
-				const auto attribValue = (pmd_attrib_value_t *)(buffer.get() + header->m_attribs_value_offset + attribDef->m_offset + i*header->m_attribs_values_size);
+				const auto attribDef = (pmd_attrib_def_t *)(buffer + header->m_attribs_offset) + k;
+				const auto attribValue = (pmd_attrib_value_t *)(buffer + header->m_attribs_value_offset + attribDef->m_offset + i*header->m_attribs_values_size);
 				Variant::Attribute attrib(attribDef->m_name.to_string());
 				switch (attribDef->m_type)
 				{
@@ -918,7 +926,7 @@ bool Model::loadCollision()
 bool Model::saveToPim(String exportPath) const
 {
 	const String pimFilePath = exportPath + m_filePath + ".pim";
-	auto file = getSFS()->open(pimFilePath, FileSystem::write | FileSystem::binary);
+	auto file = getOutputFS()->open(pimFilePath, FileSystem::write | FileSystem::binary);
 	if (!file)
 	{
 		error_f("model", m_filePath, "Unable to save model file [%s] (%s)!", pimFilePath, strerror(errno));
@@ -1497,7 +1505,7 @@ bool Model::saveToPim(String exportPath) const
 bool Model::saveToPit(String exportPath) const
 {
 	const String pitFilePath = exportPath + m_filePath + ".pit";
-	auto file = getSFS()->open(pitFilePath, FileSystem::write | FileSystem::binary);
+	auto file = getOutputFS()->open(pitFilePath, FileSystem::write | FileSystem::binary);
 	if (!file)
 	{
 		error_f("model", m_filePath, "Unable to save trait file [%s] (%s)!", pitFilePath, strerror(errno));
@@ -1556,7 +1564,7 @@ bool Model::saveToPis(String exportPath) const
 		return false;
 
 	const String pitFilePath = exportPath + m_filePath + + ".pis";
-	auto file = getSFS()->open(pitFilePath, FileSystem::write | FileSystem::binary);
+	auto file = getOutputFS()->open(pitFilePath, FileSystem::write | FileSystem::binary);
 	if (!file)
 	{
 		error_f("model", m_filePath, "Unable to save skeleton file [%s] (%s)!", pitFilePath, strerror(errno));
@@ -1608,13 +1616,70 @@ bool Model::saveToPis(String exportPath) const
 	return true;
 }
 
+Array<TextureObject *> Model::textureObjects() const
+{
+	// looks share materials and textures, every texture object is listed once
+	Array<TextureObject *> result;
+	UnorderedMap<String, TextureObject *> texturesByPath;
+	for (const auto &look : m_looks)
+	{
+		for (const auto &material : look.m_materials)
+		{
+			for (const auto &texture : material.m_textures)
+			{
+				TextureObject *const tobj = texture.texobj().get();
+				if (tobj && texturesByPath.emplace(tobj->m_filepath, tobj).second)
+				{
+					result.push_back(tobj);
+				}
+			}
+		}
+	}
+	return result;
+}
+
+void Model::releaseTextureArtifacts() const
+{
+	// texture objects outlive the model in the resource library, their textures are needed only by its export
+	for (TextureObject *const tobj : textureObjects())
+	{
+		tobj->releaseArtifacts();
+	}
+}
+
 void Model::convertTextures(String exportPath) const
 {
-	for (size_t i = 0; i < m_looks.size(); ++i)
+	const Array<TextureObject *> textureObjects = this->textureObjects();
+
+	// inside a parallel whole base conversion the cores are busy with other models already
+	if (Config::s_jobs > 1 && textureObjects.size() > 1 && !ThreadPool::isWorkerThread())
+	{
+		// output of every texture is captured and printed in order, so lines of textures do not interleave
+		Array<String> outputs(textureObjects.size());
+		ThreadPool pool(static_cast<u32>(std::min<size_t>(Config::s_jobs, textureObjects.size())));
+		for (size_t i = 0; i < textureObjects.size(); ++i)
+		{
+			pool.push([tobj = textureObjects[i], &output = outputs[i], &exportPath]
+			{
+				OutputCapture capture;
+				tobj->saveToMidFormats(exportPath);
+				output = capture.text();
+			});
+		}
+		pool.wait();
+		for (const String &output : outputs)
+		{
+			if (!output.empty())
+			{
+				print(output);
+			}
+		}
+	}
+	else
 	{
-		for (size_t j = 0; j < m_looks[i].m_materials.size(); ++j)
+		for (TextureObject *const tobj : textureObjects)
 		{
-			m_looks[i].m_materials[j].convertTextures(exportPath);
+			tobj->saveToMidFormats(exportPath);
 		}
 	}
 }
@@ -90,6 +90,9 @@ private:
 	bool loadModel0x13(const uint8_t *const buffer, const size_t size);
 	bool loadModel0x14(const uint8_t *const buffer, const size_t size);
 	bool loadModel0x15(const uint8_t *const buffer, const size_t size);
+
+	Array<TextureObject *> textureObjects() const;
+	void releaseTextureArtifacts() const;
 };
 
 class Look
@@ -56,25 +56,23 @@ bool Prefab::load(String filePath)
 	m_fileName = filePath.substr(m_directory.length() + 1);
 
 	String ppdPath = m_filePath + ".ppd";
-	auto file = getUFS()->open(ppdPath, FileSystem::read | FileSystem::binary);
+	const FileView file = getUFS()->openView(ppdPath);
 	if (!file)
 	{
 		error("prefab", m_filePath, "Unable to open file!");
 		return false;
 	}
 
-	const size_t fileSize = static_cast<size_t>(file->size());
-	UniquePtr<uint8_t[]> buffer(new uint8_t[fileSize]);
-	file->read((char *)buffer.get(), sizeof(uint8_t), fileSize);
-	file.reset();
+	const uint8_t *const buffer = file.data();
+	const size_t fileSize = file.size();
 
-	const auto version = *reinterpret_cast<const u32 *>(buffer.get());
+	const auto version = *reinterpret_cast<const u32 *>(buffer);
 
 	switch (version)
 	{
-		case ppd_0x15::ppd_header_t::SUPPORTED_VERSION: return loadVersion0x15(buffer.get(), fileSize);
-		case ppd_0x16::ppd_header_t::SUPPORTED_VERSION: return loadVersion0x16(buffer.get(), fileSize);
-		case ppd_0x17::ppd_header_t::SUPPORTED_VERSION: return loadVersion0x17(buffer.get(), fileSize);
+		case ppd_0x15::ppd_header_t::SUPPORTED_VERSION: return loadVersion0x15(buffer, fileSize);
+		case ppd_0x16::ppd_header_t::SUPPORTED_VERSION: return loadVersion0x16(buffer, fileSize);
+		case ppd_0x17::ppd_header_t::SUPPORTED_VERSION: return loadVersion0x17(buffer, fileSize);
 	}
 
 	error_f("model", m_filePath, "Invalid version of prefab file (have: %i expected: %i, %i or %i)", version,
@@ -571,7 +569,7 @@ void Prefab::destroy()
 bool Prefab::saveToPip(String exportPath) const
 {
 	String pipFilePath = exportPath + m_filePath + ".pip";
-	auto file = getSFS()->open(pipFilePath, FileSystem::write | FileSystem::binary);
+	auto file = getOutputFS()->open(pipFilePath, FileSystem::write | FileSystem::binary);
 	if (!file)
 	{
 		error_f("prefab", pipFilePath, "Unable to save file (%s)", getSFS()->getError());
@@ -26,6 +26,9 @@
 
 #include "fs/filesystem.h"
 #include "fs/file.h"
+#include "fs/deduplicator.h"
+#include "fs/memfs.h"
+#include "fs/zipwriter.h"
 #include "utils/string_utils.h"
 #include "texture/texture_object.h"
 
@@ -167,7 +170,7 @@ namespace prism
 	}
 } // namespace prism
 
-void extractFile( FileSystem &fileSystem, String filePath, FileSystem &destination )
+void extractFile( FileSystem &fileSystem, String filePath, FileSystem &destination, Deduplicator *deduplicator )
 {
 	const Optional<String > extension = extractExtension( filePath );
 	if( extension.has_value() && extension.value() == ".tobj" )
@@ -175,14 +178,33 @@ void extractFile( FileSystem &fileSystem, String filePath, FileSystem &destinati
         MetaStat metaStat;
         if( !fileSystem.mstat( &metaStat, filePath ) )
         {
-			printf( "Unable to mstat file: %s\n", filePath.c_str() );
+			print_f( "Unable to mstat file: %s\n", filePath.c_str() );
             return;
         }
 
 		if( metaStat.m_meta.size() > 0 )
 		{
-			extractTextureObject( filePath, metaStat, destination );
-			convertTextureObjectToOldFormatsIfNeeded( destination, filePath, destination );
+			if( dynamic_cast<ZipWriterFileSystem *>( &destination ) == nullptr )
+			{
+				extractTextureObject( filePath, metaStat, destination );
+				convertTextureObjectToOldFormatsIfNeeded( destination, filePath, destination );
+				return;
+			}
+
+			// conversion reads back what it extracted, archive is written only once it is done
+			MemFileSystem staging;
+			extractTextureObject( filePath, metaStat, staging );
+			convertTextureObjectToOldFormatsIfNeeded( staging, filePath, staging );
+			if( const auto files = staging.readDir( "/", true, true ) )
+			{
+				for( const auto &file : *files )
+				{
+					if( !file.IsDirectory() )
+					{
+						extractFile( staging, file.GetPath(), destination );
+					}
+				}
+			}
 			return;
 		}
 	}
@@ -191,7 +213,13 @@ void extractFile( FileSystem &fileSystem, String filePath, FileSystem &destinati
 
 	if( inputFile == nullptr )
 	{
-		printf( "Unable to open file for read: %s\n", filePath.c_str() );
+		print_f( "Unable to open file for read: %s\n", filePath.c_str() );
+		return;
+	}
+
+	if( deduplicator )
+	{
+		deduplicator->extract( fileSystem, filePath, *inputFile );
 		return;
 	}
 
@@ -199,7 +227,7 @@ void extractFile( FileSystem &fileSystem, String filePath, FileSystem &destinati
 
 	if( outputFile == nullptr )
 	{
-		printf( "Unable to open file for write: %s\n", ( destination.root( filePath ) ).c_str() );
+		print_f( "Unable to open file for write: %s\n", ( destination.root( filePath ) ).c_str() );
 		return;
 	}
 
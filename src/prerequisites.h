@@ -161,6 +161,7 @@ class SysFileSystem;
 class ZipFileSystem;
 class HashFileSystem;
 class UberFileSystem;
+class MemFileSystem;
 
 class File;
 class SysFsFile;
@@ -345,7 +346,12 @@ P alignForward( P pointer, A alignment )
 const uint32_t TEXTURE_DATA_PITCH_ALIGNMENT =       256; // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
 const uint32_t TEXTURE_DATA_PLACEMENT_ALIGNMENT =   512; // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
 
-void extractFile( FileSystem &fileSystem, String filePath, FileSystem &destination );
+class Deduplicator;
+
+/**
+ * Repeated payloads are linked instead of written when deduplicator is given.
+ */
+void extractFile( FileSystem &fileSystem, String filePath, FileSystem &destination, Deduplicator *deduplicator = nullptr );
 
 template< typename T1, typename T2 >
 T1 *as( T2 *p )
@@ -29,24 +29,48 @@
 
 auto ResourceLibrary::obtain(String tobjfile) -> Entry
 {
-	if (m_tobjs.find(tobjfile) == m_tobjs.end())
+	std::promise<Entry> promise;
+	std::shared_future<Entry> future;
+	bool loadHere = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_tobjs.find(tobjfile);
+		if (it == m_tobjs.end())
+		{
+			future = promise.get_future().share();
+			m_tobjs.insert({ tobjfile.c_str(), future });
+			loadHere = true;
+		}
+		else
+		{
+			future = it->second;
+		}
+	}
+
+	if (loadHere)
 	{
 		Entry texobj = std::make_shared<TextureObject>();
-		if (texobj->load(tobjfile))
+		// textures are kept for export of the model, the model releases them once it is done
+		if (texobj->load(tobjfile, true))
 		{
-			m_tobjs.insert({ tobjfile.c_str(), texobj });
+			promise.set_value(texobj);
 		}
 		else
 		{
 			warning("tobj", tobjfile, "Unable to load!");
-			return nullptr;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_tobjs.erase(tobjfile);
+			}
+			promise.set_value(nullptr);
 		}
 	}
-	return m_tobjs[tobjfile];
+	return future.get();
 }
 
 void ResourceLibrary::destroy()
 {
+	std::lock_guard<std::mutex> lock(m_mutex);
 	m_tobjs.clear();
 }
 
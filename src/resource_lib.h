@@ -25,6 +25,9 @@
 #include <utils/explicit_singleton.h>
 #include <material/material.h>
 
+#include <mutex>
+#include <future>
+
 class ResourceLibrary : public ExplicitSingleton<ResourceLibrary>
 {
 public:
@@ -35,7 +38,8 @@ public:
 	void destroy();
 
 private:
-	UnorderedMap<String, Entry> m_tobjs;
+	std::mutex m_mutex;
+	UnorderedMap<String, std::shared_future<Entry>> m_tobjs; // threads asking for a tobj which is being loaded wait for its future
 };
 
 /* eof */
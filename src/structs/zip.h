@@ -207,6 +207,17 @@ namespace zip
 		uint64_t relativeOffset;			// +8
 		uint32_t totalNumDisks;				// +16
 	};	static_assert(sizeof(ZIP64EndOfCentralDirectoryLocator) == 20, "Unexpected structure size");
+
+	struct ExtraFieldHeader
+	{
+		static constexpr uint16_t ZIP64_EXTENDED_INFORMATION = 0x0001;
+
+		uint16_t id;						// +0
+		uint16_t size;						// +2
+		/*
+			char data[size];
+		*/
+	};	static_assert(sizeof(ExtraFieldHeader) == 4, "Unexpected structure size");
 } // namespace Zip
 
 #pragma pack(pop)
@@ -36,6 +36,7 @@
 #include "fs/memfs.h"
 #include "structs/dds.h"
 #include "utils/format_utils.h"
+#include "utils/pixel_kernels.h"
 #include "utils/string_utils.h"
 
 bool s_ddsDxt10 = false;
@@ -46,50 +47,73 @@ static String resolveTextureFilePath( String textureFilePath, String tobjFilePat
 	return textureFilePath[ 0 ] == '/' ? textureFilePath : directory( tobjFilePath ) + "/" + textureFilePath;
 }
 
-bool TextureObject::load( String filepath )
+TextureObject::TextureObject() = default;
+
+TextureObject::~TextureObject() = default;
+
+bool TextureObject::load( String filepath, bool keepArtifacts )
 {
 	const Optional<String > extension = extractExtension( filepath );
 	assert( extension.has_value() && extension.value() == ".tobj" );
 
-	// extract and load from memory if needed
+	if( !prepareArtifacts( filepath ) )
+	{
+		return false;
+	}
+
+	UberFileSystem localUfs;
+	mountArtifacts( localUfs );
+	const bool result = load( &localUfs, filepath );
+
+	// texture objects cached by the resource library may never be exported, their textures are not held
+	if( !keepArtifacts )
+	{
+		m_artifacts.reset();
+	}
+	return result;
+}
+
+bool TextureObject::prepareArtifacts( const String &filepath )
+{
+	m_artifacts = std::make_unique<MemFileSystem>();
+	FileSystem *fs = getUFS();
 	{
 		MetaStat metaStat;
 		if( !getUFS()->mstat( &metaStat, filepath ) )
 		{
-			printf( "Unable to mstat file: %s\n", filepath.c_str() );
+			print_f( "Unable to mstat file: %s\n", filepath.c_str() );
 			return false;
 		}
 		if( metaStat.m_meta.size() > 0 )
 		{
-			MemFileSystem memFileSystem;
-			if( !extractTextureObject( filepath, metaStat, memFileSystem, false /* cannot be turned on because of cubemap image duplication remover */ ) )
+			if( !extractTextureObject( filepath, metaStat, *m_artifacts, false /* cannot be turned on because of cubemap image duplication remover */ ) )
 			{
-				printf( "Unable to extract tobj: %s\n", filepath.c_str() );
+				print_f( "Unable to extract tobj: %s\n", filepath.c_str() );
 				return false;
 			}
-			return loadPre( &memFileSystem, filepath );
+			fs = m_artifacts.get();
 		}
 	}
 
-	return loadPre( getUFS(), filepath );
-}
-
-bool TextureObject::loadPre( FileSystem *fs, String filepath )
-{
-	MemFileSystem memFileSystem;
-
-	UberFileSystem localUfs;
-	localUfs.mount( fs, 1 );
-	localUfs.mount( &memFileSystem, 2 );
-
 	// Makes sure texture object is in proper format
-	if( !convertTextureObjectToOldFormatsIfNeeded( *fs, filepath, memFileSystem, false /* cannot be turned on, because it may overwrite files on disk */ ) )
+	if( !convertTextureObjectToOldFormatsIfNeeded( *fs, filepath, *m_artifacts, false /* cannot be turned on, because it may overwrite files on disk */ ) )
 	{
-		printf( "Unable to convert tobj to old formats: %s\n", filepath.c_str() );
+		print_f( "Unable to convert tobj to old formats: %s\n", filepath.c_str() );
 		return false;
 	}
+	return true;
+}
 
-	return load( &localUfs, filepath );
+void TextureObject::releaseArtifacts()
+{
+	std::lock_guard<std::mutex> lock( m_saveMutex );
+	m_artifacts.reset();
+}
+
+void TextureObject::mountArtifacts( UberFileSystem &ufs ) const
+{
+	ufs.mount( getUFS(), 1 );
+	ufs.mount( m_artifacts.get(), 2 );
 }
 
 bool TextureObject::load( FileSystem *fs, String filepath )
@@ -190,19 +214,26 @@ bool TextureObject::loadDDS( FileSystem *fs, String filepath )
 
 bool TextureObject::saveToMidFormats( String exportpath )
 {
+	std::lock_guard<std::mutex> lock(m_saveMutex);
 	if (m_converted)
 		return true;
 
-	auto file = getSFS()->open(exportpath + m_filepath, FileSystem::write | FileSystem::binary);
+	if (m_filepath.empty())
+		return false; // not loaded
+
+	if (!m_artifacts && !prepareArtifacts(m_filepath))
+		return false;
+
+	auto file = getOutputFS()->open(exportpath + m_filepath, FileSystem::write | FileSystem::binary);
 	if (!file)
 	{
-		printf("Cannot open file: \"%s\"! %s\n" SEOL, m_filepath.c_str(), strerror(errno));
+		print_f("Cannot open file: \"%s\"! %s\n" SEOL, m_filepath.c_str(), strerror(errno));
 		return false;
 	}
 
 	if (m_type < TextureObject::_1D_MAP || m_type > TextureObject::_CUBE_MAP)
 	{
-		printf("Unsupported tobj type: \"%s\"!\n", m_filepath.c_str());
+		print_f("Unsupported tobj type: \"%s\"!\n", m_filepath.c_str());
 	}
 
 	auto mapType = [](TextureObject::Type type) -> String {
@@ -226,7 +257,7 @@ bool TextureObject::saveToMidFormats( String exportpath )
 			case TextureObject::MIRROR:				return "mirror";
 			case TextureObject::MIRROR_CLAMP:		return "mirror_clamp";
 			case TextureObject::MIRROR_CLAMP_TO_EDGE:	return "mirror_clamp_to_edge";
-			default: printf("Unknown addr type of tobj file: \"%s\"!\n", m_filepath.c_str());
+			default: print_f("Unknown addr type of tobj file: \"%s\"!\n", m_filepath.c_str());
 		}
 		return "UNKNOWN";
 	};
@@ -236,36 +267,15 @@ bool TextureObject::saveToMidFormats( String exportpath )
 			case TextureObject::NEAREST:	return "nearest";
 			case TextureObject::LINEAR:		return "linear";
 			default:
-				printf("Unknown filter type of tobj file: \"%s\"!\n", m_filepath.c_str());
+				print_f("Unknown filter type of tobj file: \"%s\"!\n", m_filepath.c_str());
 		}
 		return "UNKNOWN";
 	};
 
-	Optional< MemFileSystem > inputOptionalFileSystem;
-	{
-		MetaStat metaStat;
-		if( !getUFS()->mstat( &metaStat, m_filepath ) )
-		{
-			return false;
-		}
-		if( metaStat.m_meta.size() > 0 )
-		{
-			inputOptionalFileSystem.emplace();
-			if( !extractTextureObject( m_filepath, metaStat, inputOptionalFileSystem.value() ) )
-			{
-				printf( "Unable to extract tobj: %s\n", m_filepath.c_str() );
-				return false;
-			}
-		}
-	}
-
-	FileSystem *const inputFileSystem = inputOptionalFileSystem.has_value() ? as<FileSystem>( &inputOptionalFileSystem.value() ) : as<FileSystem>( getUFS() );
-
-	if( !convertTextureObjectToOldFormatsIfNeeded( *inputFileSystem, m_filepath, *inputFileSystem ) )
-	{
-		printf( "Unable to convert tobj to old formats: %s\n", m_filepath.c_str() );
-		return false;
-	}
+	// textures were extracted and converted by load, or just above when load did not keep them
+	UberFileSystem localUfs;
+	mountArtifacts( localUfs );
+	FileSystem *const inputFileSystem = &localUfs;
 
 	*file << fmt::sprintf("map %s" SEOL, mapType(m_type).c_str());
 	for (uint32_t i = 0; i < m_texturesCount; ++i)
@@ -275,13 +285,13 @@ bool TextureObject::saveToMidFormats( String exportpath )
 		auto inputf = inputFileSystem->open(m_textures[i], FileSystem::read | FileSystem::binary);
 		if (!inputf)
 		{
-			printf("Could not open file: \"%s\" to copy-read!\n", m_textures[i].c_str());
+			print_f("Could not open file: \"%s\" to copy-read!\n", m_textures[i].c_str());
 			continue;
 		}
-		auto outputf = getSFS()->open(exportpath + m_textures[i], FileSystem::write | FileSystem::binary);
+		auto outputf = getOutputFS()->open(exportpath + m_textures[i], FileSystem::write | FileSystem::binary);
 		if (!outputf)
 		{
-			printf("Could not open file: \"%s\" to copy-read!\n", (exportpath + m_textures[i]).c_str());
+			print_f("Could not open file: \"%s\" to copy-read!\n", (exportpath + m_textures[i]).c_str());
 			continue;
 		}
 		copyFile(inputf.get(), outputf.get());
@@ -337,6 +347,7 @@ bool TextureObject::saveToMidFormats( String exportpath )
 	}
 
 	m_converted = true;
+	m_artifacts.reset();
 	return true;
 }
 
@@ -477,59 +488,54 @@ bool extractTextureObject( const String &inputTobjFilePath, const MetaStat &inpu
 			size_t twidth, theight, tdepth, skipMap;
 			fillInitData( imgWidth, imgHeight, imgDepth, mipmapCount, imgArraySize, format, 0, inputTobjContent.size(), inputTobjContent.data(), twidth, theight, tdepth, skipMap, subdata );
 
-			u32 currentOffset = 0;
-
-			for( u32 currentFaceIndex = 0; currentFaceIndex < imgFaceCount; ++currentFaceIndex )
+			Array<SubresourceCopy> copies;
+			const uint64_t packedSize = planSubresourceCopies( subdata, mipmapCount, imgFaceCount, imgPitchAlignment, imgImageAlignment, copies );
+			for( const SubresourceCopy &copy : copies )
 			{
-				for( u32 mipmapIndex = 0; mipmapIndex < mipmapCount; ++mipmapIndex )
+				if( copy.m_source + copy.m_size > inputTobjContent.size() )
 				{
-					SubresourceData &mipmapSubdata = subdata[ mipmapIndex ];
-					const u32 slicePitch = mipmapSubdata.m_slicePitch;
-					const u32 rowPitch = mipmapSubdata.m_rowPitch;
-
-					currentOffset = alignForward( currentOffset, imgImageAlignment );
+					warning( "tobj", inputTobjFilePath, "Texture data is truncated!" );
+					return false;
+				}
+			}
 
-					for( u32 doneBytes = 0; doneBytes < slicePitch; doneBytes += rowPitch )
-					{
-						currentOffset = alignForward( currentOffset, imgPitchAlignment );
-						assert( currentOffset + rowPitch <= inputTobjContent.size() );
-						outputDDSFile->write( inputTobjContent.data() + currentOffset, sizeof( u8 ), rowPitch );
-						currentOffset += rowPitch;
-					}
+			if( copies.size() == 1 ) // no padding, data is written as it is
+			{
+				outputDDSFile->reserve( outputDDSFile->size() + packedSize );
+				outputDDSFile->write( inputTobjContent.data() + copies[ 0 ].m_source, sizeof( u8 ), packedSize );
+			}
+			else if( !copies.empty() )
+			{
+				// padded rows are gathered into one buffer, so the file is written once
+				Array<u8> packedContent( static_cast<size_t>( packedSize ) );
+				for( const SubresourceCopy &copy : copies )
+				{
+					memcpy( packedContent.data() + copy.m_destination, inputTobjContent.data() + copy.m_source, static_cast<size_t>( copy.m_size ) );
 				}
+				outputDDSFile->reserve( outputDDSFile->size() + packedSize );
+				outputDDSFile->write( packedContent.data(), sizeof( u8 ), packedContent.size() );
 			}
 		}
 	}
 	else
 	{
-		printf( "Unable to open file for write!" );
+		print_f( "Unable to open file for write!" );
 	}
 
 	return true;
 }
 
-static Array<u8> convertImageBits_B8G8R8X8_To_B8G8R8( const u8 *bits, u32 bitsLength, u32 width, u32 height, u32 facesCount, u32 imagesCount )
+static Array<u8> convertImageBits_B8G8R8X8_To_B8G8R8( const u8 *bits, size_t bitsLength )
 {
-	auto bitsConverted = Array<u8>( static_cast< size_t >( bitsLength * 3 / 4 ) );
-	u32 currentDestinationOffset = 0, currentSourceOffset = 0;
-	u32 currentImageWidth = width, currentImageHeight = height;
-	for( u32 faceIndex = 0; faceIndex < facesCount; ++faceIndex )
-	{
-		for( u32 imageIndex = 0; imageIndex < imagesCount; ++imageIndex )
-		{
-			const u32 currentImagePixelsCount = currentImageWidth * currentImageHeight;
-			for( u32 donePixels = 0; donePixels < currentImagePixelsCount; ++donePixels )
-			{
-				bitsConverted[ currentDestinationOffset + 0 ] = bits[ currentSourceOffset + 0 ];
-				bitsConverted[ currentDestinationOffset + 1 ] = bits[ currentSourceOffset + 1 ];
-				bitsConverted[ currentDestinationOffset + 2 ] = bits[ currentSourceOffset + 2 ];
-				currentDestinationOffset += 3;
-				currentSourceOffset += 4;
-			}
-			currentImageWidth = ( currentImageWidth > 1 ) ? currentImageWidth / 2 : 1;
-			currentImageHeight = ( currentImageHeight > 1 ) ? currentImageHeight / 2 : 1;
-		}
-	}
+	auto bitsConverted = Array<u8>( bitsLength / 4 * 3 );
+	PixelKernels::get().m_bgrxToBgr( bitsConverted.data(), bits, bitsLength / 4 );
+	return bitsConverted;
+}
+
+static Array<u8> convertImageBits_R8G8B8A8_To_B8G8R8A8( const u8 *bits, size_t bitsLength )
+{
+	auto bitsConverted = Array<u8>( bitsLength / 4 * 4 );
+	PixelKernels::get().m_swapRedBlue( bitsConverted.data(), bits, bitsLength / 4 );
 	return bitsConverted;
 }
 
@@ -635,9 +641,6 @@ bool convertDDSFromDX10Format( FileSystem &inputFs, const String &textureFilePat
 	ddsHeaderConverted.m_flags |= dds::header_flags::linearsize;
 	ddsHeaderConverted.m_pitch_or_linear_size = ddsHeaderConverted.m_width * ddsHeaderConverted.m_height;
 
-	const u32 facesStoredInDDS = !!( ddsHeader.m_caps2 & dds::caps2::cubemap ) ? 6 : 1;
-	const u32 imagesStoredInDDS = std::max( 1u, ddsHeader.m_mip_map_count );
-
 	const dds::dxgi_format ddsFormat = ddsHeaderDxt10.m_dxgi_format;
 
 	Optional<Array<u8>> ddsImagesBitsConverted;
@@ -675,13 +678,21 @@ bool convertDDSFromDX10Format( FileSystem &inputFs, const String &textureFilePat
 		ddsHeaderConverted.m_pixel_format = dds::PIXEL_FORMAT_B8G8R8;
 		if( ddsOnlyHeader == false )
 		{
-			ddsImagesBitsConverted = convertImageBits_B8G8R8X8_To_B8G8R8( ddsBufferBits.data(), ddsBufferBits.size(), ddsHeader.m_width, ddsHeader.m_height, facesStoredInDDS, imagesStoredInDDS );
+			ddsImagesBitsConverted = convertImageBits_B8G8R8X8_To_B8G8R8( ddsBufferBits.data(), ddsBufferBits.size() );
 		}
 	}
 	else if( ddsFormat == dds::dxgi_format::format_b8g8r8a8_unorm_srgb || ddsFormat == dds::dxgi_format::format_b8g8r8a8_unorm )
 	{
 		ddsHeaderConverted.m_pixel_format = dds::PIXEL_FORMAT_B8G8R8A8;
 	}
+	else if( ddsFormat == dds::dxgi_format::format_r8g8b8a8_unorm_srgb || ddsFormat == dds::dxgi_format::format_r8g8b8a8_unorm || ddsFormat == dds::dxgi_format::format_r8g8b8a8_typeless )
+	{
+		ddsHeaderConverted.m_pixel_format = dds::PIXEL_FORMAT_B8G8R8A8;
+		if( ddsOnlyHeader == false )
+		{
+			ddsImagesBitsConverted = convertImageBits_R8G8B8A8_To_B8G8R8A8( ddsBufferBits.data(), ddsBufferBits.size() );
+		}
+	}
 	else if( ddsFormat == dds::dxgi_format::format_r8_unorm )
 	{
 		ddsHeaderConverted.m_pixel_format = dds::PIXEL_FORMAT_R8;
@@ -699,6 +710,12 @@ bool convertDDSFromDX10Format( FileSystem &inputFs, const String &textureFilePat
 		return false;
 	}
 
+	if( ddsOnlyHeader == false )
+	{
+		const uint64_t bitsSize = ddsImagesBitsConverted.has_value() ? ddsImagesBitsConverted.value().size() : ddsBufferBits.size();
+		ddsFileOutput->reserve( sizeof( magic ) + sizeof( ddsHeaderConverted ) + bitsSize );
+	}
+
 	if( !ddsFileOutput->blockWrite( &magic, sizeof( magic ) ) ||
 		!ddsFileOutput->blockWrite( &ddsHeaderConverted, sizeof( ddsHeaderConverted ) ) )
 	{
@@ -868,6 +885,7 @@ bool disassembleCubemapTextureObject_DDS( FileSystem &inputFs, const String &tob
 		}
 
 		auto ddsFileOutput = outputFs.open( resolveTextureFilePath( currentTextureFilePath, tobjFilePath ), FileSystem::write | FileSystem::binary );
+		ddsFileOutput->reserve( sizeof( magic ) + sizeof( ddsHeaderConverted ) + sizeof( ddsHeaderDxt10Converted ) + ( ddsOnlyHeader ? 0 : faceBitsSize ) );
 
 		if( !ddsFileOutput->blockWrite( &magic, sizeof( magic ) ) ||
 			!ddsFileOutput->blockWrite( &ddsHeaderConverted, sizeof( ddsHeaderConverted ) ) ||
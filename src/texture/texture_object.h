@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <mutex>
+
 class TextureObject
 {
 public:
@@ -53,14 +55,35 @@ public:
 	};
 
 public:
-	bool load( String filepath );
+	TextureObject();
+	~TextureObject();
+
+	/**
+	 * Loads the tobj, its textures are extracted and converted into old formats on the way.
+	 * Those are kept for saveToMidFormats only if keepArtifacts is set, otherwise export repeats the work.
+	 */
+	bool load( String filepath, bool keepArtifacts = false );
 	bool saveToMidFormats( String exportpath );
 
+	/**
+	 * Drops the textures kept by load, when the texture object is not going to be exported.
+	 */
+	void releaseArtifacts();
+
 private:
-	bool loadPre( FileSystem *fs, String filepath );
 	bool load( FileSystem *fs, String filepath );
 	bool loadDDS( FileSystem *fs, String filepath );
 
+	/**
+	 * Extracts the tobj and its textures if packed and converts them into old formats.
+	 */
+	bool prepareArtifacts( const String &filepath );
+
+	/**
+	 * Mounts the extracted and converted files over the base.
+	 */
+	void mountArtifacts( UberFileSystem &ufs ) const;
+
 private:
 	uint32_t m_texturesCount = 0;
 	SizedArray<String, 6> m_textures;
@@ -82,6 +105,9 @@ private:
 
 	String m_filepath; // @example /vehicle/truck/share/glass.tobj
 	bool m_converted = false;
+	std::mutex m_saveMutex; // texture objects are shared by models exported in parallel
+
+	UniquePtr<MemFileSystem> m_artifacts; // extracted and converted files, kept by load on request until export or releaseArtifacts
 
 	bool m_tsnormal = false;
 	bool m_ui = false;
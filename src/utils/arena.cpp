@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/utils/arena.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+
+#include <prerequisites.h>
+
+#include "arena.h"
+
+Arena::Arena( size_t blockSize )
+	: m_blockSize( blockSize )
+{
+}
+
+Arena::~Arena() = default;
+
+void *Arena::allocate( size_t size, size_t alignment )
+{
+	if( size > m_blockSize / 4 )
+	{
+		Block block;
+		block.m_data.reset( new u8[ size ] ); // new[] is aligned for any fundamental type
+		block.m_size = size;
+		block.m_used = size;
+		m_reserved += size;
+		m_largeBlocks.push_back( std::move( block ) );
+		return m_largeBlocks.back().m_data.get();
+	}
+
+	if( !m_blocks.empty() )
+	{
+		Block &block = m_blocks.back();
+		const size_t offset = alignForward( block.m_used, alignment );
+		if( offset + size <= block.m_size )
+		{
+			block.m_used = offset + size;
+			return block.m_data.get() + offset;
+		}
+	}
+
+	Block block;
+	block.m_data.reset( new u8[ m_blockSize ] );
+	block.m_size = m_blockSize;
+	block.m_used = size;
+	m_reserved += m_blockSize;
+	m_blocks.push_back( std::move( block ) );
+	return m_blocks.back().m_data.get();
+}
+
+void Arena::deallocate( void *pointer, size_t size )
+{
+	if( size <= m_blockSize / 4 )
+	{
+		return; // released together with the arena
+	}
+
+	for( auto it = m_largeBlocks.begin(); it != m_largeBlocks.end(); ++it )
+	{
+		if( it->m_data.get() == pointer )
+		{
+			m_reserved -= it->m_size;
+			m_largeBlocks.erase( it );
+			return;
+		}
+	}
+	assert( false );
+}
+
+/* eof */
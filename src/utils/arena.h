@@ -0,0 +1,102 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/utils/arena.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+
+#pragma once
+
+/**
+ * Bump allocator for many buffers with common lifetime, all of them are released at once with the arena.
+ * Large allocations get a block of their own which is released as soon as they are deallocated,
+ * so memory of a buffer growing past the block size is not held until the end. Not thread-safe.
+ */
+class Arena
+{
+public:
+	static constexpr size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+public:
+	Arena( size_t blockSize = DEFAULT_BLOCK_SIZE );
+	Arena( const Arena & ) = delete;
+	Arena( Arena && ) = delete;
+	~Arena();
+
+	Arena &operator=( const Arena & ) = delete;
+	Arena &operator=( Arena && ) = delete;
+
+	void *allocate( size_t size, size_t alignment );
+	void deallocate( void *pointer, size_t size );
+
+	inline size_t reserved() const { return m_reserved; } // bytes taken from the system
+
+private:
+	struct Block
+	{
+		UniquePtr<u8[]> m_data;
+		size_t m_size = 0;
+		size_t m_used = 0;
+	};
+
+private:
+	const size_t m_blockSize;
+	Array<Block> m_blocks; // last one is the block being filled
+	Array<Block> m_largeBlocks;
+	size_t m_reserved = 0;
+};
+
+/**
+ * Standard allocator taking memory from an arena, without arena it uses the global heap.
+ */
+template< typename T >
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+public:
+	ArenaAllocator( Arena *arena = nullptr ) noexcept : m_arena( arena ) {}
+
+	template< typename U >
+	ArenaAllocator( const ArenaAllocator<U> &other ) noexcept : m_arena( other.arena() ) {}
+
+	T *allocate( size_t count )
+	{
+		return m_arena ? static_cast<T *>( m_arena->allocate( count * sizeof( T ), alignof( T ) ) ) : std::allocator<T>().allocate( count );
+	}
+
+	void deallocate( T *pointer, size_t count )
+	{
+		if( m_arena ) m_arena->deallocate( pointer, count * sizeof( T ) );
+		else std::allocator<T>().deallocate( pointer, count );
+	}
+
+	inline Arena *arena() const { return m_arena; }
+
+	template< typename U >
+	bool operator==( const ArenaAllocator<U> &other ) const { return m_arena == other.arena(); }
+	template< typename U >
+	bool operator!=( const ArenaAllocator<U> &other ) const { return m_arena != other.arena(); }
+
+private:
+	Arena *m_arena;
+};
+
+/* eof */
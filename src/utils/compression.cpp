@@ -23,6 +23,38 @@
 #include "prerequisites.h"
 
 #include "utils/compression.h"
+#include "utils/thread_pool.h"
+
+#include <atomic>
+
+extern "C"
+{
+	// libdeflate is linked together with GDeflate, its header is not shipped
+	struct libdeflate_decompressor;
+
+	libdeflate_decompressor *libdeflate_alloc_decompressor();
+	void libdeflate_free_decompressor( libdeflate_decompressor *decompressor );
+	int libdeflate_zlib_decompress( libdeflate_decompressor *decompressor, const void *in, size_t inBytes, void *out, size_t outBytesAvailable, size_t *actualOutBytes );
+	int libdeflate_deflate_decompress( libdeflate_decompressor *decompressor, const void *in, size_t inBytes, void *out, size_t outBytesAvailable, size_t *actualOutBytes );
+
+	struct libdeflate_compressor;
+
+	libdeflate_compressor *libdeflate_alloc_compressor( int compressionLevel );
+	void libdeflate_free_compressor( libdeflate_compressor *compressor );
+	size_t libdeflate_deflate_compress( libdeflate_compressor *compressor, const void *in, size_t inBytes, void *out, size_t outBytesAvailable );
+
+	struct libdeflate_gdeflate_decompressor;
+	struct libdeflate_gdeflate_in_page
+	{
+		const void *data;
+		size_t nbytes;
+	};
+
+	libdeflate_gdeflate_decompressor *libdeflate_alloc_gdeflate_decompressor();
+	void libdeflate_free_gdeflate_decompressor( libdeflate_gdeflate_decompressor *decompressor );
+	int libdeflate_gdeflate_decompress( libdeflate_gdeflate_decompressor *decompressor, libdeflate_gdeflate_in_page *inPages, size_t inPageCount,
+										void *out, size_t outBytesAvailable, size_t *actualOutBytes );
+}
 
 bool unCompress_zlib( void *output, uint64_t outputCapacity, const void *input, uint64_t inputSize )
 {
@@ -51,4 +83,207 @@ bool unCompress_zlib( void *output, uint64_t outputCapacity, const void *input,
 	return ret == Z_OK || ret == Z_STREAM_END;
 }
 
+namespace
+{
+	/**
+	 * Decompressor state is reused by every stream decoded on the same thread
+	 */
+	class DeflateDecompressor
+	{
+	public:
+		DeflateDecompressor() : m_decompressor( libdeflate_alloc_decompressor() ) {}
+		~DeflateDecompressor() { if( m_decompressor ) libdeflate_free_decompressor( m_decompressor ); }
+
+		static libdeflate_decompressor *get()
+		{
+			thread_local DeflateDecompressor instance;
+			return instance.m_decompressor;
+		}
+
+	private:
+		libdeflate_decompressor *m_decompressor;
+	};
+
+	/**
+	 * Compressor is allocated per thread and level, allocation of its match finder is expensive
+	 */
+	class DeflateCompressor
+	{
+	public:
+		DeflateCompressor( int level ) : m_compressor( libdeflate_alloc_compressor( level ) ), m_level( level ) {}
+		~DeflateCompressor() { if( m_compressor ) libdeflate_free_compressor( m_compressor ); }
+
+		static libdeflate_compressor *get( int level )
+		{
+			thread_local UniquePtr<DeflateCompressor> instance;
+			if( !instance || instance->m_level != level )
+			{
+				instance = std::make_unique<DeflateCompressor>( level );
+			}
+			return instance->m_compressor;
+		}
+
+	private:
+		libdeflate_compressor *m_compressor;
+		int m_level;
+	};
+
+	class GDeflateDecompressor
+	{
+	public:
+		GDeflateDecompressor() : m_decompressor( libdeflate_alloc_gdeflate_decompressor() ) {}
+		~GDeflateDecompressor() { if( m_decompressor ) libdeflate_free_gdeflate_decompressor( m_decompressor ); }
+
+		static libdeflate_gdeflate_decompressor *get()
+		{
+			thread_local GDeflateDecompressor instance;
+			return instance.m_decompressor;
+		}
+
+	private:
+		libdeflate_gdeflate_decompressor *m_decompressor;
+	};
+
+	/**
+	 * Helper threads shared by every GDeflate stream, started on the first read that spreads its tiles
+	 */
+	ThreadPool &tileDecodePool( u32 threadCount )
+	{
+		static ThreadPool pool( threadCount );
+		return pool;
+	}
+} // namespace
+
+bool unCompressWhole_zlib( void *output, uint64_t outputSize, const void *input, uint64_t inputSize )
+{
+	libdeflate_decompressor *const decompressor = DeflateDecompressor::get();
+	return decompressor && libdeflate_zlib_decompress( decompressor, input, static_cast<size_t>( inputSize ), output, static_cast<size_t>( outputSize ), nullptr ) == 0;
+}
+
+bool unCompressWhole_deflate( void *output, uint64_t outputSize, const void *input, uint64_t inputSize )
+{
+	libdeflate_decompressor *const decompressor = DeflateDecompressor::get();
+	return decompressor && libdeflate_deflate_decompress( decompressor, input, static_cast<size_t>( inputSize ), output, static_cast<size_t>( outputSize ), nullptr ) == 0;
+}
+
+uint64_t compressWhole_deflate( void *output, uint64_t outputCapacity, const void *input, uint64_t inputSize, int level )
+{
+	libdeflate_compressor *const compressor = DeflateCompressor::get( level );
+	return compressor ? libdeflate_deflate_compress( compressor, input, static_cast<size_t>( inputSize ), output, static_cast<size_t>( outputCapacity ) ) : 0;
+}
+
+uint64_t GDeflateStream::readHeader( const void *header, uint64_t size )
+{
+	const u8 *const bytes = static_cast<const u8 *>( header );
+	const u8 id = bytes[ 0 ];
+	const u8 magic = bytes[ 1 ];
+	u16 tileCount;
+	memcpy( &tileCount, bytes + 2, sizeof( tileCount ) );
+
+	const uint64_t expectedTileCount = ( size + TILE_SIZE - 1 ) / TILE_SIZE;
+	if( magic != ( id ^ 0xff ) || tileCount != expectedTileCount )
+	{
+		return 0;
+	}
+
+	m_size = size;
+	m_tileCount = tileCount;
+	return HEADER_SIZE + uint64_t( tileCount ) * sizeof( u32 );
+}
+
+bool GDeflateStream::readTileOffsets( const void *offsets, uint64_t compressedSize )
+{
+	m_tileOffsets.resize( m_tileCount );
+	memcpy( m_tileOffsets.data(), offsets, m_tileOffsets.size() * sizeof( u32 ) );
+
+	const uint64_t dataOffset = HEADER_SIZE + uint64_t( m_tileCount ) * sizeof( u32 );
+	for( u32 tile = 0; tile < m_tileCount; ++tile )
+	{
+		if( tileOffset( tile ) < dataOffset || tileOffset( tile ) + tileCompressedSize( tile ) > compressedSize
+		 || ( tile + 1 < m_tileCount && m_tileOffsets[ tile + 1 ] < ( tile ? m_tileOffsets[ tile ] : 0 ) ) )
+		{
+			m_tileOffsets.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t GDeflateStream::tileOffset( u32 tile ) const
+{
+	return HEADER_SIZE + uint64_t( m_tileCount ) * sizeof( u32 ) + ( tile ? m_tileOffsets[ tile ] : 0 );
+}
+
+uint64_t GDeflateStream::tileCompressedSize( u32 tile ) const
+{
+	if( tile + 1 == m_tileCount )
+	{
+		return m_tileOffsets[ 0 ];
+	}
+	return m_tileOffsets[ tile + 1 ] - ( tile ? m_tileOffsets[ tile ] : 0 );
+}
+
+uint64_t GDeflateStream::tileSize( u32 tile ) const
+{
+	return std::min<uint64_t>( TILE_SIZE, m_size - uint64_t( tile ) * TILE_SIZE );
+}
+
+bool GDeflateStream::decompress( void *output, const void *input, u32 first, u32 count, u32 workers ) const
+{
+	const u8 *const base = static_cast<const u8 *>( input ) - tileOffset( first );
+	std::atomic<u32> nextTile = { first };
+	std::atomic<bool> failed = { false };
+
+	const auto work = [ & ]()
+	{
+		libdeflate_gdeflate_decompressor *const decompressor = GDeflateDecompressor::get();
+		for( u32 tile = nextTile++; tile < first + count && !failed; tile = nextTile++ )
+		{
+			libdeflate_gdeflate_in_page page = { base + tileOffset( tile ), static_cast<size_t>( tileCompressedSize( tile ) ) };
+			u8 *const out = static_cast<u8 *>( output ) + uint64_t( tile - first ) * TILE_SIZE;
+			size_t written = 0;
+			if( !decompressor
+			 || libdeflate_gdeflate_decompress( decompressor, &page, 1, out, static_cast<size_t>( tileSize( tile ) ), &written ) != 0
+			 || written != tileSize( tile ) )
+			{
+				failed = true;
+			}
+		}
+	};
+
+	// the calling thread decodes as well, helpers are queued only if there is enough tiles for them,
+	// inside a pool task the tiles are decoded serially as the other workers are busy already
+	u32 helpers = std::min( workers, count / 2 ) > 1 ? std::min( workers, count / 2 ) - 1 : 0;
+	if( helpers == 0 || ThreadPool::isWorkerThread() )
+	{
+		work();
+		return !failed;
+	}
+
+	ThreadPool &pool = tileDecodePool( std::max( workers, 2u ) - 1 );
+	helpers = std::min( helpers, pool.threadCount() );
+
+	std::mutex mutex;
+	std::condition_variable finished;
+	u32 running = helpers;
+	for( u32 i = 0; i < helpers; ++i )
+	{
+		pool.push( [ & ]()
+		{
+			work();
+			std::lock_guard<std::mutex> lock( mutex );
+			if( --running == 0 )
+			{
+				finished.notify_one();
+			}
+		} );
+	}
+	work();
+
+	// helpers reference this frame, wait for them even if the caller has finished all tiles
+	std::unique_lock<std::mutex> lock( mutex );
+	finished.wait( lock, [ & ] { return running == 0; } );
+	return !failed;
+}
+
 /* eof */
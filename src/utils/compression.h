@@ -24,4 +24,55 @@
 
 bool unCompress_zlib(void *output, uint64_t outputCapacity, const void *input, uint64_t inputSize);
 
+/**
+ * One-shot decompression of a complete stream with libdeflate, output must be filled up exactly.
+ * Much faster than streaming inflate when the whole entry is read at once.
+ */
+bool unCompressWhole_zlib( void *output, uint64_t outputSize, const void *input, uint64_t inputSize );
+bool unCompressWhole_deflate( void *output, uint64_t outputSize, const void *input, uint64_t inputSize ); // raw deflate, without zlib wrapper
+
+/**
+ * One-shot raw deflate compression with libdeflate.
+ * Returns compressed size, or 0 if the output does not fit into outputCapacity (data is incompressible).
+ */
+uint64_t compressWhole_deflate( void *output, uint64_t outputCapacity, const void *input, uint64_t inputSize, int level = 6 );
+
+/**
+ * GDeflate stream split into 64KB tiles, each of them can be decompressed independently.
+ * Layout: 8-byte header, table of u32 tile offsets (first slot holds size of the last tile), tile data.
+ */
+class GDeflateStream
+{
+public:
+	static constexpr u32 TILE_SIZE = 64 * 1024;
+	static constexpr uint64_t HEADER_SIZE = 8;
+
+public:
+	/**
+	 * Validates the header against uncompressed size of the stream.
+	 * Returns size of header with tile offset table, or 0 if the stream is not valid.
+	 */
+	uint64_t readHeader( const void *header, uint64_t size );
+	bool readTileOffsets( const void *offsets, uint64_t compressedSize );
+
+	inline u32 tileCount() const { return m_tileCount; }
+	inline u32 tileAt( uint64_t offset ) const { return static_cast<u32>( offset / TILE_SIZE ); }
+
+	uint64_t tileOffset( u32 tile ) const; // relative to the beginning of the stream
+	uint64_t tileCompressedSize( u32 tile ) const;
+	uint64_t tileSize( u32 tile ) const;
+
+	/**
+	 * Decompresses tiles [first, first + count) into output.
+	 * Input points to compressed data of the first tile, tiles are spread over up to workers threads
+	 * of a shared decode pool, unless called from a pool task.
+	 */
+	bool decompress( void *output, const void *input, u32 first, u32 count, u32 workers ) const;
+
+private:
+	uint64_t m_size = 0;
+	u32 m_tileCount = 0;
+	Array<u32> m_tileOffsets;
+};
+
 /* eof */
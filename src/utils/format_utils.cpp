@@ -388,4 +388,37 @@ bool fillInitData( size_t width,
     return ( index > 0 );
 }
 
+uint64_t planSubresourceCopies( const SubresourceData *subresources, uint32_t mipCount, uint32_t faceCount, uint32_t pitchAlignment, uint32_t imageAlignment, Array<SubresourceCopy> &outCopies )
+{
+    outCopies.clear();
+
+    uint64_t source = 0;
+    uint64_t destination = 0;
+    for( uint32_t face = 0; face < faceCount; ++face )
+    {
+        for( uint32_t mip = 0; mip < mipCount; ++mip )
+        {
+            const uint32_t slicePitch = subresources[ mip ].m_slicePitch;
+            const uint32_t rowPitch = subresources[ mip ].m_rowPitch;
+
+            source = alignForward( source, imageAlignment );
+            for( uint32_t doneBytes = 0; doneBytes < slicePitch; doneBytes += rowPitch )
+            {
+                source = alignForward( source, pitchAlignment );
+                if( !outCopies.empty() && outCopies.back().m_source + outCopies.back().m_size == source )
+                {
+                    outCopies.back().m_size += rowPitch; // destination is always contiguous
+                }
+                else
+                {
+                    outCopies.push_back( SubresourceCopy{ source, destination, rowPitch } );
+                }
+                source += rowPitch;
+                destination += rowPitch;
+            }
+        }
+    }
+    return destination;
+}
+
 /* eof */
@@ -51,4 +51,21 @@ bool fillInitData( size_t width,
                    size_t &skipMip,
                    /* [mipCount * arraySize] */ SubresourceData *initData );
 
+/**
+ * Run of bytes copied from the aligned layout of texture data into the packed dds layout.
+ */
+struct SubresourceCopy
+{
+    uint64_t m_source;
+    uint64_t m_destination;
+    uint64_t m_size;
+};
+
+/**
+ * Plans copy of every face and mipmap from layout with rows and images aligned (tobj data) into packed layout (dds data).
+ * Rows already contiguous in the source are merged into a single copy, so unpadded data ends up as one run.
+ * Returns size of the packed data.
+ */
+uint64_t planSubresourceCopies( const SubresourceData *subresources, uint32_t mipCount, uint32_t faceCount, uint32_t pitchAlignment, uint32_t imageAlignment, Array<SubresourceCopy> &outCopies );
+
 /* eof */
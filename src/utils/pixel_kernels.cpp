@@ -0,0 +1,240 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/utils/pixel_kernels.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+
+#include <prerequisites.h>
+
+#include "pixel_kernels.h"
+
+#include <chrono>
+
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+#define CP_PIXEL_KERNELS_X86 1
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define CP_TARGET( ISA )
+#else
+#define CP_TARGET( ISA ) __attribute__( ( target( ISA ) ) )
+#endif
+#endif
+
+namespace
+{
+	void bgrxToBgr_scalar( u8 *output, const u8 *input, size_t pixelCount )
+	{
+		for( size_t i = 0; i < pixelCount; ++i, output += 3, input += 4 )
+		{
+			output[ 0 ] = input[ 0 ];
+			output[ 1 ] = input[ 1 ];
+			output[ 2 ] = input[ 2 ];
+		}
+	}
+
+	void swapRedBlue_scalar( u8 *output, const u8 *input, size_t pixelCount )
+	{
+		for( size_t i = 0; i < pixelCount; ++i, output += 4, input += 4 )
+		{
+			const u8 red = input[ 0 ];
+			output[ 0 ] = input[ 2 ];
+			output[ 1 ] = input[ 1 ];
+			output[ 2 ] = red;
+			output[ 3 ] = input[ 3 ];
+		}
+	}
+
+#if CP_PIXEL_KERNELS_X86
+	CP_TARGET( "ssse3" ) void bgrxToBgr_ssse3( u8 *output, const u8 *input, size_t pixelCount )
+	{
+		const __m128i shuffle = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+		size_t i = 0;
+		// 16 bytes are stored for 12 bytes of output, the rest is overwritten by the next store
+		for( ; i + 8 <= pixelCount; i += 4, output += 12, input += 16 )
+		{
+			const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i *>( input ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i *>( output ), _mm_shuffle_epi8( pixels, shuffle ) );
+		}
+		bgrxToBgr_scalar( output, input, pixelCount - i );
+	}
+
+	CP_TARGET( "ssse3" ) void swapRedBlue_ssse3( u8 *output, const u8 *input, size_t pixelCount )
+	{
+		const __m128i shuffle = _mm_setr_epi8( 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 );
+		size_t i = 0;
+		for( ; i + 4 <= pixelCount; i += 4, output += 16, input += 16 )
+		{
+			const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i *>( input ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i *>( output ), _mm_shuffle_epi8( pixels, shuffle ) );
+		}
+		swapRedBlue_scalar( output, input, pixelCount - i );
+	}
+
+	CP_TARGET( "avx2" ) void bgrxToBgr_avx2( u8 *output, const u8 *input, size_t pixelCount )
+	{
+		// 12 bytes are packed in every lane, then the lanes are joined into 24 contiguous bytes
+		const __m256i shuffle = _mm256_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+												  0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+		const __m256i join = _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 3, 7 );
+		size_t i = 0;
+		for( ; i + 16 <= pixelCount; i += 8, output += 24, input += 32 )
+		{
+			const __m256i pixels = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( input ) );
+			const __m256i packed = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8( pixels, shuffle ), join );
+			_mm256_storeu_si256( reinterpret_cast<__m256i *>( output ), packed );
+		}
+		bgrxToBgr_ssse3( output, input, pixelCount - i );
+	}
+
+	CP_TARGET( "avx2" ) void swapRedBlue_avx2( u8 *output, const u8 *input, size_t pixelCount )
+	{
+		const __m256i shuffle = _mm256_setr_epi8( 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+												  2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 );
+		size_t i = 0;
+		for( ; i + 8 <= pixelCount; i += 8, output += 32, input += 32 )
+		{
+			const __m256i pixels = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( input ) );
+			_mm256_storeu_si256( reinterpret_cast<__m256i *>( output ), _mm256_shuffle_epi8( pixels, shuffle ) );
+		}
+		swapRedBlue_ssse3( output, input, pixelCount - i );
+	}
+
+	bool supports( PixelKernels::Level level )
+	{
+		switch( level )
+		{
+#if defined( _MSC_VER )
+			case PixelKernels::SSSE3:
+			{
+				int info[ 4 ];
+				__cpuid( info, 1 );
+				return ( info[ 2 ] & ( 1 << 9 ) ) != 0;
+			}
+			case PixelKernels::AVX2:
+			{
+				int info[ 4 ];
+				__cpuid( info, 1 );
+				const bool osSavesYmm = ( info[ 2 ] & ( 1 << 27 ) ) != 0 && ( _xgetbv( 0 ) & 6 ) == 6;
+				__cpuidex( info, 7, 0 );
+				return osSavesYmm && ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+			}
+#else
+			case PixelKernels::SSSE3: return __builtin_cpu_supports( "ssse3" );
+			case PixelKernels::AVX2: return __builtin_cpu_supports( "avx2" );
+#endif
+			default: return level == PixelKernels::SCALAR;
+		}
+	}
+#else
+	bool supports( PixelKernels::Level level )
+	{
+		return level == PixelKernels::SCALAR;
+	}
+#endif
+
+	const PixelKernels c_kernels[ PixelKernels::LEVEL_COUNT ] =
+	{
+		{ bgrxToBgr_scalar, swapRedBlue_scalar },
+#if CP_PIXEL_KERNELS_X86
+		{ bgrxToBgr_ssse3, swapRedBlue_ssse3 },
+		{ bgrxToBgr_avx2, swapRedBlue_avx2 },
+#else
+		{ bgrxToBgr_scalar, swapRedBlue_scalar },
+		{ bgrxToBgr_scalar, swapRedBlue_scalar },
+#endif
+	};
+} // namespace
+
+const PixelKernels &PixelKernels::get()
+{
+	static const PixelKernels &best = [] () -> const PixelKernels &
+	{
+		for( int level = LEVEL_COUNT - 1; level > SCALAR; --level )
+		{
+			if( supports( static_cast<Level>( level ) ) )
+			{
+				return c_kernels[ level ];
+			}
+		}
+		return c_kernels[ SCALAR ];
+	}();
+	return best;
+}
+
+const PixelKernels *PixelKernels::get( Level level )
+{
+	return level < LEVEL_COUNT && supports( level ) ? &c_kernels[ level ] : nullptr;
+}
+
+const char *PixelKernels::levelName( Level level )
+{
+	switch( level )
+	{
+		case SCALAR: return "scalar";
+		case SSSE3: return "ssse3";
+		case AVX2: return "avx2";
+		default: return "unknown";
+	}
+}
+
+void benchmarkPixelKernels()
+{
+	constexpr size_t pixelCount = 4 * 1024 * 1024; // 16 MB of input, a 2048x2048 texture
+	constexpr int repeatCount = 20;
+
+	Array<u8> input( pixelCount * 4 );
+	for( size_t i = 0; i < input.size(); ++i )
+	{
+		input[ i ] = static_cast<u8>( i * 7 );
+	}
+	Array<u8> output( pixelCount * 4 );
+
+	struct Entry
+	{
+		const char *m_name;
+		PixelKernels::Kernel PixelKernels::*m_kernel;
+	};
+	const Entry entries[] = { { "bgrx -> bgr", &PixelKernels::m_bgrxToBgr }, { "rgba <-> bgra", &PixelKernels::m_swapRedBlue } };
+
+	for( const Entry &entry : entries )
+	{
+		for( int level = PixelKernels::SCALAR; level < PixelKernels::LEVEL_COUNT; ++level )
+		{
+			const PixelKernels *const kernels = PixelKernels::get( static_cast<PixelKernels::Level>( level ) );
+			if( !kernels )
+			{
+				printf( "%-14s %-7s: not supported\n", entry.m_name, PixelKernels::levelName( static_cast<PixelKernels::Level>( level ) ) );
+				continue;
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			for( int i = 0; i < repeatCount; ++i )
+			{
+				( kernels->*entry.m_kernel )( output.data(), input.data(), pixelCount );
+			}
+			const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+			printf( "%-14s %-7s: %8.1f MB/s\n", entry.m_name, PixelKernels::levelName( static_cast<PixelKernels::Level>( level ) ),
+					( input.size() * repeatCount ) / ( 1024.0 * 1024.0 ) / std::max( seconds, 1e-9 ) );
+		}
+	}
+}
+
+/* eof */
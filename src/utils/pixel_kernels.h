@@ -0,0 +1,66 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/utils/pixel_kernels.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+
+#pragma once
+
+/**
+ * Repacking of 8-bit per channel pixels between texture formats.
+ * Every kernel has a scalar variant and SSSE3 and AVX2 variants on x86, the best one supported by the CPU is selected at runtime.
+ */
+class PixelKernels
+{
+public:
+	enum Level
+	{
+		SCALAR,
+		SSSE3,
+		AVX2,
+		LEVEL_COUNT
+	};
+
+	using Kernel = void ( * )( u8 *output, const u8 *input, size_t pixelCount );
+
+public:
+	Kernel m_bgrxToBgr;		// drops the fourth byte of every pixel, output has 3 bytes per pixel
+	Kernel m_swapRedBlue;	// RGBA <-> BGRA, output may be the same as input
+
+public:
+	/**
+	 * Returns kernels of the best level supported by the CPU.
+	 */
+	static const PixelKernels &get();
+
+	/**
+	 * Returns kernels of the given level, nullptr when the CPU does not support it.
+	 */
+	static const PixelKernels *get( Level level );
+
+	static const char *levelName( Level level );
+};
+
+/**
+ * Prints throughput of every kernel at every supported level.
+ */
+void benchmarkPixelKernels();
+
+/* eof */
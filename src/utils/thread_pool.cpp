@@ -0,0 +1,153 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/utils/thread_pool.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool( u32 threadCount )
+{
+	threadCount = std::max( threadCount, 1u );
+
+	m_queues.reserve( threadCount );
+	for( u32 i = 0; i < threadCount; ++i )
+	{
+		m_queues.push_back( std::make_unique<Queue>() );
+	}
+
+	m_threads.reserve( threadCount );
+	for( u32 i = 0; i < threadCount; ++i )
+	{
+		m_threads.emplace_back( [ this, i ] { workerMain( i ); } );
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_stop = true;
+	}
+	m_wakeUp.notify_all();
+	for( std::thread &thread : m_threads )
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::push( Task task )
+{
+	m_pending.fetch_add( 1 );
+
+	Queue &queue = *m_queues[ m_nextQueue.fetch_add( 1 ) % m_queues.size() ];
+	{
+		// counted under the queue lock, takeTask uncounts it under the same lock after taking it
+		std::lock_guard<std::mutex> lock( queue.m_mutex );
+		m_queued.fetch_add( 1 );
+		queue.m_tasks.push_back( std::move( task ) );
+	}
+	{
+		// idle workers test m_queued under m_mutex, notifying under it cannot be missed
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_wakeUp.notify_one();
+	}
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_finished.wait( lock, [ this ] { return m_pending.load() == 0; } );
+}
+
+u32 ThreadPool::hardwareThreadCount()
+{
+	return std::max( std::thread::hardware_concurrency(), 1u );
+}
+
+namespace
+{
+	thread_local bool s_workerThread = false;
+} // namespace
+
+bool ThreadPool::isWorkerThread()
+{
+	return s_workerThread;
+}
+
+void ThreadPool::workerMain( u32 index )
+{
+	s_workerThread = true;
+	for( ;; )
+	{
+		Task task;
+		if( !takeTask( index, task ) )
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_wakeUp.wait( lock, [ this ] { return m_stop || m_queued.load() > 0; } );
+			if( m_stop && m_queued.load() == 0 )
+			{
+				return;
+			}
+			continue;
+		}
+
+		task();
+		task = nullptr;
+
+		if( m_pending.fetch_sub( 1 ) == 1 )
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_finished.notify_all();
+		}
+	}
+}
+
+bool ThreadPool::takeTask( u32 index, Task &task )
+{
+	const size_t queueCount = m_queues.size();
+	for( size_t i = 0; i < queueCount; ++i )
+	{
+		Queue &queue = *m_queues[ ( index + i ) % queueCount ];
+		std::lock_guard<std::mutex> lock( queue.m_mutex );
+		if( queue.m_tasks.empty() )
+		{
+			continue;
+		}
+
+		if( i == 0 ) // own queue, keep submission order
+		{
+			task = std::move( queue.m_tasks.front() );
+			queue.m_tasks.pop_front();
+		}
+		else // steal from the other end
+		{
+			task = std::move( queue.m_tasks.back() );
+			queue.m_tasks.pop_back();
+		}
+		m_queued.fetch_sub( 1 );
+		return true;
+	}
+	return false;
+}
+
+/* eof */
@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/utils/thread_pool.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+/**
+ * Work-stealing pool of worker threads.
+ * Every worker owns a queue and takes its tasks in submission order,
+ * an idle worker steals from the back of the other queues.
+ */
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+public:
+	ThreadPool( u32 threadCount );
+	ThreadPool( const ThreadPool & ) = delete;
+	ThreadPool( ThreadPool && ) = delete;
+	~ThreadPool();
+
+	ThreadPool &operator=( const ThreadPool & ) = delete;
+	ThreadPool &operator=( ThreadPool && ) = delete;
+
+	void push( Task task );
+
+	/**
+	 * Blocks until every pushed task has finished.
+	 */
+	void wait();
+
+	inline u32 threadCount() const { return static_cast<u32>( m_threads.size() ); }
+
+	static u32 hardwareThreadCount();
+
+	/**
+	 * Returns true when called from a task of any pool, nested work should not spawn another pool then.
+	 */
+	static bool isWorkerThread();
+
+private:
+	struct Queue
+	{
+		std::mutex m_mutex;
+		std::deque<Task> m_tasks;
+	};
+
+private:
+	void workerMain( u32 index );
+	bool takeTask( u32 index, Task &task );
+
+private:
+	Array<UniquePtr<Queue>> m_queues;
+	Array<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	std::condition_variable m_finished;
+
+	std::atomic<u64> m_queued = { 0 };
+	std::atomic<u64> m_pending = { 0 }; // queued and running
+	std::atomic<u32> m_nextQueue = { 0 };
+	bool m_stop = false;
+};
+
+/* eof */